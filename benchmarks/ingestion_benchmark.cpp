@@ -2,6 +2,7 @@
 
 #include "ingestion/data_ingestion.hpp"
 #include "ingestion/config.hpp"
+#include "ingestion/pipeline.hpp"
 
 #include <iostream>
 #include <thread>
@@ -9,16 +10,40 @@
 #include <memory>
 #include <cstdlib>
 #include <vector>
+#include <cstring>
+#include <algorithm>
 #include <unistd.h> // for sysconf
+#include <pthread.h>
+#include <sched.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 
-// Function to simulate a server sending test messages with CPU pinning
-void simulate_server(int port, int num_messages, int interval_us, int cpu_core)
+// Function to simulate a server sending test messages with CPU pinning. With a
+// replay_path the server streams that capture file instead, at replay_speed.
+void simulate_server(int port, int num_messages, int interval_us, int cpu_core, const std::string& replay_path,
+                     const std::string& replay_speed)
 {
     // Build the command to run the mock server with CPU affinity
-    std::string command = "taskset -c " + std::to_string(cpu_core) + " ./mock_server " +
-                          std::to_string(port) + " " +
-                          std::to_string(num_messages) + " " +
-                          std::to_string(interval_us) + " STOP";
+    std::string command = "taskset -c ";
+    command += std::to_string(cpu_core);
+    command += " ./mock_server ";
+    command += std::to_string(port);
+    if (replay_path.empty())
+    {
+        command += " ";
+        command += std::to_string(num_messages);
+        command += " ";
+        command += std::to_string(interval_us);
+        command += " STOP";
+    }
+    else
+    {
+        command += " STOP --replay=";
+        command += replay_path;
+        command += " --speed=";
+        command += replay_speed;
+    }
     int ret = system(command.c_str());
     if (ret != 0)
     {
@@ -26,6 +51,175 @@ void simulate_server(int port, int num_messages, int interval_us, int cpu_core)
     }
 }
 
+// perf_event_open counter for this thread and every thread it starts afterwards (the
+// ingest threads and consumers, but not the mock server). Reports -1 where perf events
+// are not permitted or the PMU is not exposed, as in many VMs and containers.
+class PerfCounter
+{
+public:
+    PerfCounter(uint32_t type, uint64_t config)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    ~PerfCounter()
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    // Counts of exited inherited threads are folded in, so read after joining them
+    long long read_value() const
+    {
+        uint64_t value = 0;
+        if (fd_ < 0 || read(fd_, &value, sizeof(value)) != sizeof(value))
+        {
+            return -1;
+        }
+        return static_cast<long long>(value);
+    }
+
+private:
+    int fd_ = -1;
+};
+
+// Count records from one shard (or the shared queue when shard is SIZE_MAX) and note
+// when the last one arrived
+ConsumerTask count_records(DataIngestion& ingestion, size_t shard, size_t& count,
+                           std::chrono::high_resolution_clock::time_point& last_record)
+{
+    while (true)
+    {
+        std::vector<std::shared_ptr<DataRecord>> batch =
+            co_await (shard == SIZE_MAX ? ingestion.next_batch() : ingestion.next_shard_batch(shard));
+        if (batch.empty())
+        {
+            break;
+        }
+        count += batch.size();
+        last_record = std::chrono::high_resolution_clock::now();
+        for (auto& record : batch)
+        {
+            ingestion.recycle(std::move(record));
+        }
+    }
+}
+
+// Ingest through DataIngestion with coroutine consumers; returns the records consumed
+size_t run_ingestion(const IngestionConfig& config, std::chrono::high_resolution_clock::time_point& start_time,
+                     std::chrono::high_resolution_clock::time_point& end_time, double& startup_ms,
+                     ArenaStats& arena)
+{
+    // Start Data Ingestion; construction maps the arena and fills the pool
+    auto constructing = std::chrono::high_resolution_clock::now();
+    DataIngestion ingestion(config);
+    startup_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - constructing).count();
+    arena = ingestion.get_arena_stats();
+    ingestion.start();
+
+    // Capture start time right before sending messages
+    start_time = std::chrono::high_resolution_clock::now();
+
+    // Consumers park in next_batch() instead of polling, so they do not compete with
+    // the ingest threads for CPU
+    ConsumerExecutor executor(config.consumer_cores);
+    size_t num_consumers = ingestion.num_shards() > 0 ? ingestion.num_shards() : 1;
+    std::vector<size_t> counts(num_consumers, 0);
+    std::vector<std::chrono::high_resolution_clock::time_point> last_records(num_consumers, start_time);
+    for (size_t i = 0; i < num_consumers; ++i)
+    {
+        size_t shard = ingestion.num_shards() > 0 ? i : SIZE_MAX;
+        executor.spawn(count_records(ingestion, shard, counts[i], last_records[i]), i);
+    }
+
+    // Wait for the STOP message, then for the consumers to drain everything
+    while (ingestion.is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ingestion.stop();
+    executor.wait();
+
+    size_t total = 0;
+    end_time = start_time;
+    for (size_t i = 0; i < num_consumers; ++i)
+    {
+        total += counts[i];
+        end_time = std::max(end_time, last_records[i]);
+    }
+    return total;
+}
+
+// Sink of the compile-time pipeline mode
+struct CountingSink
+{
+    size_t count = 0;
+
+    void operator()(const RecordView&)
+    {
+        ++count;
+    }
+};
+
+// The benchmark feed through a compile-time Pipeline: TCP, the endpoint's framing
+// fixed at compile time, and one SPSC record ring to a consumer thread
+template <typename Decoder>
+size_t run_pipeline(const IngestionConfig& config, Decoder decoder,
+                    std::chrono::high_resolution_clock::time_point& last_record)
+{
+    const EndpointConfig& endpoint = config.endpoints.front();
+    Pipeline<TcpTransport, Decoder, SystemClockMs, SpscRecordRing, CountingSink, StopMessage> pipeline(
+        0, TcpTransport(endpoint.host, endpoint.port, config.buffer_size, config.socket_rcvbuf),
+        std::move(decoder), CountingSink());
+
+    std::thread consumer([&pipeline, &last_record]()
+    {
+        while (true)
+        {
+            bool done = pipeline.finished();
+            if (pipeline.poll() > 0)
+            {
+                last_record = std::chrono::high_resolution_clock::now();
+            }
+            else if (done)
+            {
+                break;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Receive on the first ingestion core, as DataIngestion would
+    if (!config.ingestion_cores.empty())
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(config.ingestion_cores.front(), &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+    pipeline.run();
+    consumer.join();
+    return pipeline.sink().count;
+}
+
 int main(int argc, char* argv[])
 {
     // Determine the number of available CPU cores
@@ -36,105 +230,138 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // Configuration: defaults, then --config=<file> or INGESTION_CONFIG, then
+    // INGESTION_* environment variables, then --key=value arguments
+    IngestionConfig config;
+    if (!load_config(argc, argv, config))
+    {
+        std::cerr << "Invalid configuration.\n";
+        return -1;
+    }
+
+    // Positional arguments
+    // Usage: ./ingestion_benchmark [mock_server_core] [ingestion_thread_core1,ingestion_thread_core2,...] [ingestion|pipeline]
+    //        [capture_file [replay_speed]] [--key=value ...]
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            positional.push_back(argv[i]);
+        }
+    }
+
     // Default CPU cores
     int mock_server_core = 1;
-    std::vector<int> ingestion_thread_cores = {2};
-
-    // Parse command-line arguments
-    // Usage: ./ingestion_benchmark [mock_server_core] [ingestion_thread_core1,ingestion_thread_core2,...]
-    if (argc >= 2)
+    if (positional.size() >= 1)
     {
-        mock_server_core = std::stoi(argv[1]);
+        mock_server_core = std::stoi(positional[0]);
         if (mock_server_core < 0 || mock_server_core >= num_cores)
         {
             std::cerr << "Invalid mock_server_core. Must be between 0 and " << num_cores - 1 << ".\n";
             return -1;
         }
     }
-    if (argc >= 3)
+    if (positional.size() >= 2 && (!parse_core_list(positional[1], config.ingestion_cores) || config.ingestion_cores.empty()))
     {
-        // Assume comma-separated core numbers
-        std::string cores_str = argv[2];
-        ingestion_thread_cores.clear();
-        size_t start = 0;
-        size_t end = cores_str.find(',');
-        while (end != std::string::npos)
-        {
-            int core = std::stoi(cores_str.substr(start, end - start));
-            if (core >= 0 && core < num_cores)
-            {
-                ingestion_thread_cores.push_back(core);
-            }
-            else
-            {
-                std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
-                return -1;
-            }
-            start = end + 1;
-            end = cores_str.find(',', start);
-        }
-        // Last core
-        int core = std::stoi(cores_str.substr(start));
-        if (core >= 0 && core < num_cores)
+        std::cerr << "Invalid ingestion_thread_core list: " << positional[1] << "\n";
+        return -1;
+    }
+    for (int core : config.ingestion_cores)
+    {
+        if (core >= num_cores)
         {
-            ingestion_thread_cores.push_back(core);
+            std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
+            return -1;
         }
-        else
+    }
+
+    // "pipeline" runs the first endpoint through a compile-time Pipeline instead of DataIngestion
+    bool pipeline_mode = false;
+    if (positional.size() >= 3)
+    {
+        if (positional[2] != "ingestion" && positional[2] != "pipeline")
         {
-            std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
+            std::cerr << "Invalid mode: " << positional[2] << ". Must be ingestion or pipeline.\n";
             return -1;
         }
+        pipeline_mode = positional[2] == "pipeline";
     }
 
-    // Configuration
-    IngestionConfig config = get_default_config();
+    // A capture file replaces the synthetic messages with recorded traffic, sent as fast
+    // as possible unless a replay speed is given
+    std::string replay_path = positional.size() >= 4 ? positional[3] : "";
+    std::string replay_speed = positional.size() >= 5 ? positional[4] : "0";
 
     // Test parameters
     int num_messages = 100000; // Adjust as needed for benchmarking
     int interval_us = 1;        // Microseconds between messages
 
+    // The benchmark drives an outbound feed
+    if (config.endpoints.empty())
+    {
+        std::cerr << "The benchmark needs at least one endpoint.\n";
+        return -1;
+    }
+    if (pipeline_mode && config.endpoints.front().transport != Transport::Tcp)
+    {
+        std::cerr << "Pipeline mode drives a TCP endpoint.\n";
+        return -1;
+    }
+
     // Start mock server in a separate thread
-    std::thread server_thread(simulate_server, config.port, num_messages, interval_us, mock_server_core);
+    std::thread server_thread(simulate_server, config.endpoints.front().port, num_messages, interval_us, mock_server_core,
+                              replay_path, replay_speed);
 
     // Give the server a moment to start
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
-    // Start Data Ingestion
-    DataIngestion ingestion(config.ip, config.port, ingestion_thread_cores);
-    ingestion.start();
+    // Opened after the server thread started, so only our own threads are counted
+    PerfCounter tlb_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    PerfCounter page_faults(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
 
-    // Capture start time right before sending messages
+    size_t total = 0;
+    double startup_ms = 0.0;
+    ArenaStats arena;
     auto start_time = std::chrono::high_resolution_clock::now();
-
-    // Wait for the ingestion module to process all messages
-    std::shared_ptr<DataRecord> record;
-    while (ingestion.get_data(record))
+    auto end_time = start_time;
+    if (!pipeline_mode)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        total = run_ingestion(config, start_time, end_time, startup_ms, arena);
     }
-
-    // Stop ingestion
-    ingestion.stop();
-
-    // Capture end time after processing
-    auto end_time = std::chrono::high_resolution_clock::now();
-
-    // Calculate duration
-    std::chrono::duration<double> duration = end_time - start_time;
-
-    // Retrieve ingested data
-    std::vector<std::shared_ptr<DataRecord>> data;
-    while (ingestion.get_data(record))
+    else if (config.endpoints.front().decoder == DecoderType::LengthPrefixed)
+    {
+        total = run_pipeline(config, LengthPrefixedDecoder(config.max_frame_size), end_time);
+    }
+    else
     {
-        data.push_back(record);
+        total = run_pipeline(config, LineDecoder(config.max_frame_size), end_time);
     }
 
+    // Time from start until the last record was consumed
+    std::chrono::duration<double> duration = end_time - start_time;
+
     // Calculate and display messages per second
-    double msgs_per_sec = data.size() / duration.count();
+    double msgs_per_sec = duration.count() > 0 ? total / duration.count() : 0.0;
     std::cout << "Benchmark Results:\n";
-    std::cout << "Total Messages Ingested: " << data.size() << std::endl;
+    std::cout << "Total Messages Ingested: " << total << std::endl;
     std::cout << "Time Taken: " << duration.count() << " seconds" << std::endl;
     std::cout << "Throughput: " << msgs_per_sec << " messages/second" << std::endl;
+    if (!pipeline_mode)
+    {
+        std::cout << "Startup: " << startup_ms << " ms (memory on " << arena_backing_name(arena.backing);
+        if (arena.reserved > 0)
+        {
+            std::cout << ", " << arena.reserved / (1024 * 1024) << " MB arena reserved in " << arena.reserve_ns / 1000000.0
+                      << " ms, " << arena.heap_fallbacks << " heap fallbacks";
+        }
+        std::cout << ")" << std::endl;
+    }
+    long long misses = tlb_misses.read_value();
+    long long faults = page_faults.read_value();
+    std::cout << "dTLB load misses: " << (misses >= 0 ? std::to_string(misses) : std::string("unavailable"))
+              << ", page faults: " << (faults >= 0 ? std::to_string(faults) : std::string("unavailable")) << std::endl;
 
     // Join server thread
     if (server_thread.joinable())
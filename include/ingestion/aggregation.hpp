@@ -0,0 +1,250 @@
+// include/ingestion/aggregation.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config.hpp"
+#include "data_ingestion.hpp"
+
+// Mergeable Quantile Sketch
+// Values fall into logarithmic buckets whose bounds grow by gamma = (1 + a) / (1 - a),
+// so any quantile is reported within relative accuracy a of a true sample value.
+// Merging two sketches adds their bucket counts, which makes per-core partials and
+// sliding panes cheap to combine. Each sign keeps at most MAX_BUCKETS buckets; beyond
+// that the smallest magnitudes are folded together.
+class QuantileSketch
+{
+public:
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+
+    void add(double value);
+    void merge(const QuantileSketch& other);
+
+    // Value at quantile q in [0, 1]; 0 when empty
+    double quantile(double q) const;
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    // Keeps the bucket storage for reuse
+    void reset();
+
+private:
+    static const size_t MAX_BUCKETS = 2048;
+
+    // Bucket counts for one sign, starting at bucket index offset
+    struct Store
+    {
+        std::vector<uint64_t> counts;
+        int32_t offset = 0;
+
+        void add(int32_t index, uint64_t count);
+        void reset();
+    };
+
+    Store positive_;
+    Store negative_;
+    uint64_t zero_count_ = 0;
+    uint64_t count_ = 0;
+};
+
+// HyperLogLog distinct-count estimator, 2^PRECISION one-byte registers (about 3%
+// standard error). Merging takes the register-wise maximum. Registers are allocated on
+// the first add, so unused estimators cost nothing.
+class HyperLogLog
+{
+public:
+    static const int PRECISION = 10;
+
+    void add(uint64_t hash);
+    void merge(const HyperLogLog& other);
+    uint64_t estimate() const;
+    void reset();
+
+private:
+    std::vector<uint8_t> registers_;
+};
+
+// Running statistics for one key in one pane or window
+struct KeyAggregate
+{
+    uint64_t count = 0;    // Records
+    uint64_t valued = 0;   // Records whose value field parsed as a number
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    QuantileSketch values;
+    HyperLogLog distinct;
+
+    void reset();
+    void merge(const KeyAggregate& other);
+};
+
+// Open-Addressed Key Table
+// Linear probing over a flat slot array holding the full hash, so a probe touches one
+// cache line until the key bytes are compared. Key bytes live in one arena string and
+// aggregates in a dense vector in insertion order. clear() keeps every allocation,
+// including each aggregate's sketch buffers, for the next pane.
+class KeyTable
+{
+public:
+    KeyTable();
+
+    KeyAggregate& find_or_insert(uint32_t feed_id, std::string_view key, uint64_t hash);
+
+    // Calls f(feed_id, key, aggregate) in insertion order
+    template <typename F>
+    void for_each(F&& f) const
+    {
+        for (size_t i = 0; i < size_; ++i)
+        {
+            const Entry& entry = entries_[i];
+            f(entry.feed_id, std::string_view(keys_.data() + entry.key_offset, entry.key_length), aggregates_[i]);
+        }
+    }
+
+    // Merge every key of other into this table
+    void merge(const KeyTable& other);
+
+    void clear();
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t hash;      // 0 marks an empty slot
+        uint32_t entry;
+    };
+
+    struct Entry
+    {
+        uint64_t hash;
+        uint32_t feed_id;
+        uint32_t key_length;
+        size_t key_offset;
+    };
+
+    void grow();
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    std::vector<Entry> entries_;
+    std::vector<KeyAggregate> aggregates_;  // Grows only; entries past size_ are spare
+    std::string keys_;
+};
+
+// Hash of a (feed, key) pair as used by KeyTable; never 0
+uint64_t aggregation_key_hash(uint32_t feed_id, std::string_view key);
+
+struct WindowKeyResult
+{
+    uint32_t feed_id = 0;
+    std::string key;
+    KeyAggregate aggregate;
+};
+
+struct WindowResult
+{
+    uint64_t start_ms = 0;
+    uint64_t end_ms = 0;   // Exclusive
+    uint64_t records = 0;
+    std::vector<WindowKeyResult> keys;
+};
+
+struct AggregationStats
+{
+    uint64_t records = 0;
+    uint64_t late = 0;          // Older than every window still open; not aggregated
+    uint64_t unparsed = 0;      // Counted, but the value field was missing or not numeric
+    uint64_t windows = 0;       // Windows closed and reported
+};
+
+// Window Aggregator
+// Consumers fold their batches into per-partial state (one partial per consumer, so a
+// partial's lock is uncontended except while a window closes). Time is cut into panes
+// of slide_ms; a window is the last window_ms / slide_ms panes. The watermark is the
+// lowest newest-timestamp among partials that have data, so a consumer running ahead
+// cannot close a window a slower one is still filling. Once the watermark passes a
+// window's end plus lateness_ms, whichever consumer notices merges that window's panes
+// from every partial into one table and reports it, then frees the panes no later
+// window needs.
+class WindowAggregator
+{
+public:
+    using WindowCallback = std::function<void(const WindowResult&)>;
+
+    WindowAggregator(const AggregationConfig& config, size_t partials, WindowCallback on_window);
+
+    // Fold records into the given partial, then close any windows that became due
+    void add(size_t partial, const std::vector<std::shared_ptr<DataRecord>>& batch);
+
+    // Close windows ending at or before watermark_ms - lateness_ms, e.g. from a timer
+    // while feeds are idle
+    void advance(uint64_t watermark_ms);
+
+    // Close every window that still holds data
+    void flush();
+
+    AggregationStats stats() const;
+
+    uint64_t window_ms() const
+    {
+        return panes_per_window_ * slide_ms_;
+    }
+
+    uint64_t slide_ms() const
+    {
+        return slide_ms_;
+    }
+
+private:
+    struct alignas(64) Partial
+    {
+        std::mutex mutex;
+        std::map<uint64_t, std::unique_ptr<KeyTable>> panes;  // By pane index
+        std::vector<std::unique_ptr<KeyTable>> spare;
+        std::atomic<uint64_t> newest{0};  // Highest timestamp folded in; 0 before any data
+        std::atomic<uint64_t> records{0};
+        std::atomic<uint64_t> late{0};
+        std::atomic<uint64_t> unparsed{0};
+    };
+
+    void close_through(uint64_t end_pane, bool wait);
+
+    AggregationConfig config_;
+    uint64_t slide_ms_;
+    uint64_t panes_per_window_;
+    size_t max_field_;
+    WindowCallback on_window_;
+    std::vector<std::unique_ptr<Partial>> partials_;
+
+    // Exclusive end pane of the next window to close; 0 until the first record
+    std::atomic<uint64_t> next_end_pane_{0};
+    std::atomic<uint64_t> windows_{0};
+
+    std::mutex close_mutex_;
+    KeyTable merged_;  // Guarded by close_mutex_
+};
@@ -0,0 +1,196 @@
+// include/ingestion/arena.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "config.hpp"
+
+// What actually backs an arena; reservation falls through this list top to bottom
+enum class ArenaBacking
+{
+    HugePages1G,   // hugetlbfs 1 GB pages (arenas of at least 1 GB)
+    HugePages2M,   // hugetlbfs 2 MB pages
+    Transparent,   // Regular mapping with MADV_HUGEPAGE, 2 MB aligned
+    SmallPages,    // Regular 4 KB pages
+    Heap           // No arena; every allocation goes to the heap
+};
+
+const char* arena_backing_name(ArenaBacking backing);
+
+struct ArenaStats
+{
+    ArenaBacking backing = ArenaBacking::Heap;
+    size_t reserved = 0;          // Bytes mapped
+    size_t used = 0;              // Bytes handed out
+    uint64_t heap_fallbacks = 0;  // Allocations that did not fit and went to the heap
+    uint64_t reserve_ns = 0;      // Time to map, prefault and lock the arena
+    bool locked = false;
+};
+
+// Arena
+// One region mapped at startup, on the largest pages the system grants, prefaulted and
+// optionally locked so the hot path never takes a page fault or walks 4 KB page tables.
+// Allocation is a lock-free bump of an offset. Arena memory is never reused: blocks
+// handed back are simply abandoned until the arena is unmapped, so structures that
+// churn (queue nodes) recycle their blocks themselves. Once the arena is exhausted,
+// allocations transparently go to the heap and are freed normally.
+class Arena
+{
+public:
+    // Heap only
+    Arena() = default;
+
+    explicit Arena(const MemoryConfig& config);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+    void deallocate(void* block, size_t size, size_t alignment);
+
+    bool contains(const void* block) const
+    {
+        const char* address = static_cast<const char*>(block);
+        return address >= base_ && address < base_ + size_;
+    }
+
+    ArenaStats stats() const;
+
+private:
+    bool map(size_t size, int flags, ArenaBacking backing);
+
+    char* base_ = nullptr;
+    size_t size_ = 0;
+    ArenaBacking backing_ = ArenaBacking::Heap;
+    bool locked_ = false;
+    uint64_t reserve_ns_ = 0;
+    alignas(64) std::atomic<size_t> used_{0};
+    std::atomic<uint64_t> heap_fallbacks_{0};
+};
+
+// Construct and destroy single objects and arrays in an arena, or on the heap when
+// arena is nullptr
+template <typename T, typename... Args>
+T* arena_new(Arena* arena, Args&&... args)
+{
+    void* block = arena != nullptr ? arena->allocate(sizeof(T), alignof(T))
+                                   : ::operator new(sizeof(T), std::align_val_t(alignof(T)));
+    return new (block) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void arena_delete(Arena* arena, T* object)
+{
+    if (object == nullptr)
+    {
+        return;
+    }
+    object->~T();
+    if (arena != nullptr)
+    {
+        arena->deallocate(object, sizeof(T), alignof(T));
+    }
+    else
+    {
+        ::operator delete(object, std::align_val_t(alignof(T)));
+    }
+}
+
+template <typename T>
+T* arena_new_array(Arena* arena, size_t count)
+{
+    void* block = arena != nullptr ? arena->allocate(count * sizeof(T), alignof(T))
+                                   : ::operator new(count * sizeof(T), std::align_val_t(alignof(T)));
+    T* objects = static_cast<T*>(block);
+    for (size_t i = 0; i < count; ++i)
+    {
+        new (objects + i) T();
+    }
+    return objects;
+}
+
+template <typename T>
+void arena_delete_array(Arena* arena, T* objects, size_t count)
+{
+    if (objects == nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        objects[i].~T();
+    }
+    if (arena != nullptr)
+    {
+        arena->deallocate(objects, count * sizeof(T), alignof(T));
+    }
+    else
+    {
+        ::operator delete(objects, std::align_val_t(alignof(T)));
+    }
+}
+
+// Standard allocator over an arena, for containers and std::allocate_shared. It holds
+// the arena by shared_ptr: a pooled record a consumer still holds keeps the mapping
+// alive after its DataIngestion is gone.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    explicit ArenaAllocator(std::shared_ptr<Arena> arena = nullptr)
+        : arena_(std::move(arena))
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena_(other.arena())
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        if (arena_)
+        {
+            return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+    }
+
+    void deallocate(T* block, size_t count)
+    {
+        if (arena_)
+        {
+            arena_->deallocate(block, count * sizeof(T), alignof(T));
+        }
+        else
+        {
+            ::operator delete(block, std::align_val_t(alignof(T)));
+        }
+    }
+
+    const std::shared_ptr<Arena>& arena() const
+    {
+        return arena_;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return arena_ == other.arena();
+    }
+
+private:
+    std::shared_ptr<Arena> arena_;
+};
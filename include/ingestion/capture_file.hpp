@@ -0,0 +1,131 @@
+// include/ingestion/capture_file.hpp
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+
+// Capture File Format
+// Raw bytes exactly as one ingest thread received them, for offline replay
+// (mock_server --replay). A CaptureFileHeader is followed by one chunk per stream recv
+// or datagram: a CaptureChunkHeader, then the bytes. timestamp_ns is the wall-clock
+// receive time. Every connection (each accept, connect or reconnect, and each UDP
+// socket) gets its own stream id, so inbound producers sharing the listener's feed id
+// can be told apart. Replaying keeps the original chunk boundaries, so datagrams go
+// out as the same datagrams.
+struct CaptureFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct CaptureChunkHeader
+{
+    uint64_t timestamp_ns;
+    uint32_t feed_id;
+    uint32_t stream;       // Numbered from 1 within one capture file
+    uint32_t length;
+    uint8_t framing;       // DecoderType of the connection
+    uint8_t reserved[3];
+};
+
+// Append-only capture file owned by a single ingest thread. Chunks are buffered and
+// written sequentially; after a write error the capture stops and later appends are
+// ignored, so a full disk never stalls ingestion.
+class CaptureWriter
+{
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    bool open(const std::string& path);
+
+    // Flushes buffered chunks and closes the file
+    void close();
+
+    bool append(uint64_t timestamp_ns, uint32_t feed_id, uint32_t stream, DecoderType framing, const char* data,
+                size_t size);
+
+    // Stream id for a new connection
+    uint32_t next_stream()
+    {
+        return ++streams_;
+    }
+
+    const std::string& path() const
+    {
+        return path_;
+    }
+
+    uint64_t chunks() const
+    {
+        return chunks_;
+    }
+
+    // Payload bytes, excluding chunk headers
+    uint64_t bytes() const
+    {
+        return bytes_;
+    }
+
+private:
+    bool flush();
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t chunks_ = 0;
+    uint64_t bytes_ = 0;
+    uint32_t streams_ = 0;
+    std::vector<char> write_buffer_;
+
+    static const size_t WRITE_BUFFER_SIZE = 256 * 1024;
+};
+
+// One chunk of a mapped capture file; data points into the mapping
+struct CaptureChunk
+{
+    uint64_t timestamp_ns = 0;
+    uint32_t feed_id = 0;
+    uint32_t stream = 0;
+    uint32_t length = 0;
+    DecoderType framing = DecoderType::Line;
+    const char* data = nullptr;
+};
+
+// Maps a capture file read-only and walks its chunks in order. A chunk cut short by a
+// capture that did not shut down cleanly ends the walk.
+class CaptureReader
+{
+public:
+    CaptureReader() = default;
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool next(CaptureChunk& chunk);
+
+    // Back to the first chunk
+    void rewind();
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+};
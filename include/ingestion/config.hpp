@@ -2,15 +2,250 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <vector>
+
+// Sharding Configuration Structure
+// When num_shards > 0 the ingest thread hashes a key field out of every frame and
+// routes the record to one of num_shards SPSC queues instead of the shared queue.
+struct ShardingConfig
+{
+    size_t num_shards = 0;          // 0 disables sharding
+    char key_delimiter = ',';       // Field separator inside a frame
+    size_t key_field = 0;           // Zero-based index of the field used as routing key
+    size_t queue_capacity = 65536;  // Slots per SPSC queue (rounded up to a power of two)
+};
+
+// What the ingest loop does while a watermark is exceeded
+enum class OverloadPolicy
+{
+    PauseRead,   // Stop reading the socket and let TCP flow control push back on the sender
+    DropOldest,  // Discard the oldest queued record for every new one admitted
+    DropNewest,  // Discard incoming records and count them
+    SpillToDisk  // Append incoming records to a spill file, replayed once below the low watermark
+};
+
+// Flow Control Configuration Structure
+// Overload starts when either high watermark is reached and ends once both gauges
+// are back at or below their low watermarks. A zero high watermark disables that gauge.
+struct FlowControlConfig
+{
+    size_t queue_high_watermark = 0;  // Records queued (shared queue plus all shard queues)
+    size_t queue_low_watermark = 0;
+    size_t pool_high_watermark = 0;   // DataRecords handed out by the pool and not yet recycled
+    size_t pool_low_watermark = 0;
+    size_t pool_max_size = 0;         // Hard cap on pool growth; 0 expands without bound
+    OverloadPolicy policy = OverloadPolicy::PauseRead;
+    std::string spill_path = "ingestion.spill"; // Per-thread files are suffixed with the thread index
+};
+
+// How a byte stream is split into records
+enum class DecoderType
+{
+    Line,           // Newline-terminated frames
+    LengthPrefixed, // 4-byte big-endian length followed by the payload
+    Datagram        // UDP only: every datagram is exactly one record
+};
+
+// How an endpoint's bytes arrive
+enum class Transport
+{
+    Tcp,  // Stream connection to host:port
+    Udp   // Datagrams received on host:port; a multicast host joins that group
+};
+
+// How ingest threads wait for socket readiness
+enum class WaitPolicy
+{
+    Epoll,    // Block in epoll_wait for up to epoll_timeout_ms
+    BusyPoll  // Spin on epoll_wait with a zero timeout (lowest latency, burns the core)
+};
+
+// Network address of a feed server
+struct EndpointAddress
+{
+    std::string host;  // Numeric IPv4 address
+    int port = 0;
+};
+
+// Endpoint Configuration Structure
+// One endpoint is one logical feed. Backups are tried in order once the current
+// address has failed failover_after consecutive connects; after a disconnect the
+// feed always retries its primary first. For UDP the Line and LengthPrefixed
+// decoders split multi-record datagrams; frames never span datagrams.
+struct EndpointConfig
+{
+    std::string host;
+    int port = 0;
+    DecoderType decoder = DecoderType::Line;
+    Transport transport = Transport::Tcp;
+    std::vector<EndpointAddress> backups;
+};
+
+// Reconnect Configuration Structure
+// Delays double from initial_ms up to max_ms and are jittered into [delay/2, delay]
+// so that many feeds dropping at once do not reconnect in lockstep.
+struct ReconnectConfig
+{
+    bool enabled = true;           // false: a closed connection ends its feed
+    int initial_ms = 100;
+    int max_ms = 30000;
+    int connect_timeout_ms = 3000;
+    int failover_after = 3;        // Consecutive connect failures before moving to the next address
+};
+
+// Datagram Configuration Structure
+// Applies to every UDP endpoint. Each ingestion thread owns batch * max_datagram
+// bytes of receive buffers for recvmmsg.
+struct UdpConfig
+{
+    size_t batch = 64;               // Datagrams per recvmmsg call
+    size_t max_datagram = 9000;      // Larger datagrams are truncated by the kernel and counted
+    std::string interface = "0.0.0.0"; // Local interface address for multicast joins
+};
+
+// Shared-Memory Output Configuration Structure
+// With a name set, ingest threads publish records into a named shared-memory segment
+// (one ring per thread) for consumer processes instead of the in-process queues.
+struct ShmConfig
+{
+    std::string name;                    // shm_open name such as "/ingestion"; empty disables
+    size_t ring_bytes = 64 * 1024 * 1024; // Per ingestion thread, rounded up to a power of two
+    size_t max_readers = 16;             // Attached consumer processes, at most 64
+};
+
+// How one filter pattern is matched against a frame
+enum class FilterMatch
+{
+    Contains, // Anywhere in the frame
+    Prefix,   // At the start of the frame
+    Field     // Equal to one delimiter-separated field
+};
+
+struct FilterPattern
+{
+    FilterMatch match = FilterMatch::Contains;
+    std::string text;
+    size_t field = 0;  // Zero-based, for FilterMatch::Field
+};
+
+// Filter Configuration Structure
+// Frames are tested on the receive buffer, before any pool, queue, spill or
+// shared-memory work. A frame matches when any pattern does; keep_matching selects
+// whether matching frames are the ones ingested or the ones discarded. No patterns
+// disables the filter.
+struct FilterConfig
+{
+    std::vector<FilterPattern> patterns;
+    bool keep_matching = true;
+    char field_delimiter = ',';
+};
+
+// History Configuration Structure
+// Every feed keeps its most recent records, as received and after the filter, in a
+// ring of bytes_per_feed bytes that can be queried by timestamp range. The listener
+// keeps one ring per ingestion thread.
+struct HistoryConfig
+{
+    size_t bytes_per_feed = 0;  // 0 disables history
+};
+
+// Capture Configuration Structure
+// Every ingest thread writes the raw bytes it receives, with receive timestamps, to
+// path.<thread index>, for replay with mock_server --replay.
+struct CaptureConfig
+{
+    std::string path;  // Empty disables capture
+};
+
+// Aggregation Configuration Structure
+// Windowed per-key statistics over consumed records, keyed by feed and one
+// delimiter-separated field. Windows are window_ms long and start every slide_ms
+// (tumbling when slide_ms is 0 or equals window_ms); window_ms is rounded up to a
+// multiple of slide_ms. Windows follow DataRecord::timestamp.
+struct AggregationConfig
+{
+    size_t window_ms = 0;     // 0 disables aggregation
+    size_t slide_ms = 0;
+    size_t lateness_ms = 100; // A window closes once the watermark is this far past its end
+    char delimiter = ',';
+    size_t key_field = 0;
+    int value_field = 1;      // Numeric field for sum, min, max and quantiles; -1 counts only
+    int distinct_field = -1;  // Field whose distinct values are estimated per key; -1 disables
+};
+
+// Listener Configuration Structure
+// Producers dial in instead of being dialed. Every ingestion thread binds its own
+// SO_REUSEPORT socket on the same address so the kernel spreads accepts across cores.
+struct ListenConfig
+{
+    std::string host;                // Empty disables the listener
+    int port = 0;
+    DecoderType decoder = DecoderType::Line;
+    int backlog = 1024;
+    bool incoming_cpu = false;       // Set SO_INCOMING_CPU to the thread's core on each socket
+};
+
+// Memory Configuration Structure
+// Hot-path memory (receive buffers, pooled records, queue nodes, shard rings and
+// history) is carved from one arena reserved at construction, on huge pages where the
+// system has them. Allocations that do not fit fall back to the heap.
+struct MemoryConfig
+{
+    size_t arena_bytes = 0;   // 0 keeps everything on the heap
+    bool huge_pages = true;   // Try hugetlbfs pages, then transparent huge pages
+    bool prefault = true;     // Fault every page in at startup rather than on first use
+    bool lock = false;        // mlock the arena; needs a large enough RLIMIT_MEMLOCK
+};
 
 // Ingestion Configuration Structure
+// Fields marked "runtime" may be changed on a live DataIngestion via reload();
+// everything else is structural and only takes effect on construction.
 struct IngestionConfig
 {
-    std::string ip;
-    int port;
-    // Add more configuration parameters as needed
+    std::vector<EndpointConfig> endpoints;    // Spread round-robin across ingestion threads
+    ListenConfig listen;                      // Inbound producers; one feed id after the endpoints
+    std::vector<int> ingestion_cores = {2};   // One ingestion thread per core
+    std::vector<int> consumer_cores;          // Optional pinning for shard consumers
+    size_t buffer_size = 4096;                // Per-thread recv buffer in bytes
+    size_t pool_size = 10000;                 // DataRecords preallocated per pool expansion
+    size_t max_frame_size = 1024 * 1024;      // Larger frames are treated as a protocol error
+    int max_events = 10000;                   // epoll_wait batch size
+    int socket_rcvbuf = 8 * 1024 * 1024;      // runtime: SO_RCVBUF for new sockets
+    int epoll_timeout_ms = 1000;              // runtime
+    WaitPolicy wait_policy = WaitPolicy::Epoll; // runtime
+    ReconnectConfig reconnect;                // runtime
+    UdpConfig udp;
+    ShmConfig shm;
+    ShardingConfig sharding;
+    FilterConfig filter;
+    HistoryConfig history;
+    CaptureConfig capture;
+    MemoryConfig memory;
+    AggregationConfig aggregation;            // Applied by the consumers, not by DataIngestion
+    FlowControlConfig flow_control;           // runtime except pool_max_size and spill_path
 };
 
 // Function to retrieve default configuration
 IngestionConfig get_default_config();
+
+// Set a single "key = value" setting, e.g. ("flow.policy", "drop_newest").
+// Returns false and reports to std::cerr on an unknown key or malformed value.
+bool set_config_value(IngestionConfig& config, const std::string& key, const std::string& value);
+
+// Apply a file of "key = value" lines; '#' starts a comment.
+bool load_config_file(const std::string& path, IngestionConfig& config);
+
+// Apply INGESTION_<KEY> environment variables, with '.' in the key written as '_'.
+bool apply_env_overrides(IngestionConfig& config);
+
+// Apply "--key=value" arguments; other arguments are left for the caller.
+bool apply_cli_overrides(int argc, char* argv[], IngestionConfig& config);
+
+// Defaults, then the file named by --config= or INGESTION_CONFIG, then the
+// environment, then the command line.
+bool load_config(int argc, char* argv[], IngestionConfig& config);
+
+// Parse a comma-separated list of CPU core numbers
+bool parse_core_list(const std::string& text, std::vector<int>& cores);
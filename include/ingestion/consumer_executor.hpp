@@ -0,0 +1,150 @@
+// include/ingestion/consumer_executor.hpp
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ConsumerExecutor;
+
+// Fire-and-forget consumer coroutine. It does not start until handed to
+// ConsumerExecutor::spawn and frees itself when it returns.
+class ConsumerTask
+{
+public:
+    struct promise_type
+    {
+        ConsumerExecutor* executor = nullptr;
+
+        ConsumerTask get_return_object()
+        {
+            return ConsumerTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        // Reports completion to the executor; the frame is destroyed on return
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+
+            void await_resume() noexcept
+            {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    ConsumerTask(ConsumerTask&& other) noexcept
+        : handle_(other.handle_)
+    {
+        other.handle_ = nullptr;
+    }
+
+    ConsumerTask(const ConsumerTask&) = delete;
+    ConsumerTask& operator=(const ConsumerTask&) = delete;
+
+    ~ConsumerTask()
+    {
+        // Never spawned
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+private:
+    friend class ConsumerExecutor;
+
+    explicit ConsumerTask(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Consumer Executor
+// A few worker threads, each optionally pinned to a core, run many consumer
+// coroutines. A coroutine stays on the worker it was spawned on: when it parks in
+// co_await DataIngestion::next_batch(), the producer that wakes it posts it back to
+// that worker's run queue. Idle workers sleep on a condition variable.
+class ConsumerExecutor
+{
+public:
+    // One worker per entry; -1 leaves that worker unpinned
+    explicit ConsumerExecutor(const std::vector<int>& cores);
+    ~ConsumerExecutor();
+
+    ConsumerExecutor(const ConsumerExecutor&) = delete;
+    ConsumerExecutor& operator=(const ConsumerExecutor&) = delete;
+
+    // Start task on the given worker (round-robin when worker is out of range)
+    void spawn(ConsumerTask task, size_t worker = SIZE_MAX);
+
+    // Queue a suspended coroutine to resume on worker
+    void schedule(std::coroutine_handle<> handle, size_t worker);
+
+    // Block until every spawned task has returned
+    void wait();
+
+    size_t size() const
+    {
+        return workers_.size();
+    }
+
+    // Executor and worker index of the calling thread, if it is a worker
+    static ConsumerExecutor* current();
+    static size_t current_worker();
+
+private:
+    friend struct ConsumerTask::promise_type::FinalAwaiter;
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::coroutine_handle<>> run_queue;
+        std::thread thread;
+    };
+
+    void run(size_t index, int core);
+    void task_finished();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> next_worker_{0};
+
+    std::mutex tasks_mutex_;
+    std::condition_variable tasks_done_;
+    size_t live_tasks_ = 0;
+};
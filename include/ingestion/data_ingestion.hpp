@@ -3,22 +3,34 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <thread>
 #include <atomic>
 #include <vector>
 #include <memory>
 #include <cstddef>
+#include <mutex>
+#include <coroutine>
 
 // Include memory pool
 #include "memory_pool.hpp"
+#include "spsc_queue.hpp"
+#include "sharding.hpp"
+#include "config.hpp"
+#include "shm_ring.hpp"
+#include "consumer_executor.hpp"
+#include "record_filter.hpp"
+#include "history.hpp"
 
 // Lock-Free Queue Implementation using std::shared_ptr
+// Nodes come from the arena (or the heap without one) and are recycled through a
+// TaggedStack instead of being freed, so steady-state enqueues do not allocate.
 template <typename T>
 class LockFreeQueue
 {
 public:
-    LockFreeQueue()
-        : head_(new Node()), tail_(head_.load(std::memory_order_relaxed))
+    explicit LockFreeQueue(Arena* arena = nullptr)
+        : arena_(arena), head_(arena_new<Node>(arena)), tail_(head_.load(std::memory_order_relaxed))
     {
     }
 
@@ -27,31 +39,62 @@ public:
         while (Node* old_head = head_.load(std::memory_order_relaxed))
         {
             head_.store(old_head->next, std::memory_order_relaxed);
-            delete old_head;
+            arena_delete(arena_, old_head);
+        }
+        Node* spare = free_nodes_.take_all();
+        while (spare != nullptr)
+        {
+            Node* next = spare->next.load(std::memory_order_relaxed);
+            arena_delete(arena_, spare);
+            spare = next;
         }
     }
 
     void enqueue(std::shared_ptr<T> value)
     {
-        Node* new_node = new Node(value);
+        Node* new_node = free_nodes_.pop();
+        if (new_node == nullptr)
+        {
+            new_node = arena_new<Node>(arena_);
+        }
+        new_node->data = std::move(value);
+        new_node->next.store(nullptr, std::memory_order_relaxed);
         Node* prev_tail = tail_.exchange(new_node, std::memory_order_acq_rel);
         prev_tail->next.store(new_node, std::memory_order_release);
+        enqueued_.fetch_add(1, std::memory_order_relaxed);
     }
 
+    // Producers never block; concurrent consumers (e.g. a drop-oldest producer)
+    // serialize on a consumer-side spin flag.
     bool dequeue(std::shared_ptr<T>& result)
     {
+        while (consumer_lock_.test_and_set(std::memory_order_acquire))
+        {
+        }
         Node* old_head = head_.load(std::memory_order_acquire);
         Node* next = old_head->next.load(std::memory_order_acquire);
         if (next == nullptr)
         {
+            consumer_lock_.clear(std::memory_order_release);
             return false;
         }
-        result = next->data;
+        result = std::move(next->data);
         head_.store(next, std::memory_order_release);
-        delete old_head;
+        dequeued_.store(dequeued_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        consumer_lock_.clear(std::memory_order_release);
+        // The producer that linked old_head->next was its last user
+        free_nodes_.push(old_head);
         return true;
     }
 
+    // Approximate number of queued elements
+    size_t size() const
+    {
+        size_t dequeued = dequeued_.load(std::memory_order_relaxed);
+        size_t enqueued = enqueued_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
 private:
     struct Node
     {
@@ -62,28 +105,95 @@ private:
             : data(nullptr), next(nullptr)
         {
         }
-
-        Node(std::shared_ptr<T> val)
-            : data(val), next(nullptr)
-        {
-        }
     };
 
+    Arena* arena_;
     std::atomic<Node*> head_;
     std::atomic<Node*> tail_;
+
+    // Depth accounting kept on separate lines for producers and the consumer
+    alignas(64) std::atomic<size_t> enqueued_{0};
+    alignas(64) std::atomic<size_t> dequeued_{0};
+    std::atomic_flag consumer_lock_ = ATOMIC_FLAG_INIT;
+    TaggedStack<Node> free_nodes_;
 };
 
 // DataRecord Structure
 struct alignas(64) DataRecord
 {
     uint64_t timestamp;
+    uint32_t feed_id = 0;  // Index into IngestionConfig::endpoints; endpoints.size() for inbound producers
     std::string message;
 };
 
+// Flow Control Statistics
+struct FlowControlStats
+{
+    uint64_t pauses = 0;          // Times an ingest thread stopped reading its socket
+    uint64_t dropped_newest = 0;  // Incoming records discarded (policy or pool exhaustion)
+    uint64_t dropped_oldest = 0;  // Queued records discarded to admit newer ones
+    uint64_t spilled = 0;         // Records written to spill files
+    uint64_t unspilled = 0;       // Spilled records replayed into the queues
+    size_t queue_depth = 0;       // Records currently queued
+    size_t pool_in_use = 0;       // DataRecords handed out and not yet recycled
+};
+
+// Per-feed Connection Statistics
+// The listener, when enabled, is reported as one extra feed aggregating every
+// accepted producer connection across all ingestion threads.
+struct ConnectionStats
+{
+    size_t feed_id = 0;
+    std::string address;            // host:port currently in use (listen address for the listener)
+    bool connected = false;         // For the listener: at least one producer connected
+    bool finished = false;          // STOP received, or reconnect disabled and the peer closed
+    uint64_t connects = 0;          // Successful connects (accepted connections for the listener)
+    uint64_t connect_failures = 0;  // Refused, timed out or otherwise failed attempts
+    uint64_t disconnects = 0;       // Established connections that were lost
+    uint64_t failovers = 0;         // Moves to the next address after repeated failures
+    uint64_t bytes_received = 0;
+    uint64_t records = 0;           // Frames decoded on this feed
+    uint64_t filtered = 0;          // Frames rejected by the filter before enqueue
+    uint64_t datagrams = 0;         // UDP: datagrams received
+    uint64_t bad_datagrams = 0;     // UDP: truncated by the kernel or not decodable, discarded
+    uint64_t kernel_drops = 0;      // UDP: datagrams dropped on a full socket queue (SO_RXQ_OVFL)
+};
+
+struct IngestThreadState;
+struct FeedConnection;
+class DataIngestion;
+
+// Awaitable returned by DataIngestion::next_batch(). Resumes with up to max_records
+// records; an empty batch means ingestion has finished and everything was consumed.
+// A consumer that finds nothing parks without a thread; the ingest thread that next
+// publishes fills its batch and posts it back to the ConsumerExecutor worker it ran on.
+class RecordBatchAwaitable
+{
+public:
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> handle);
+    std::vector<std::shared_ptr<DataRecord>> await_resume();
+
+private:
+    friend class DataIngestion;
+
+    RecordBatchAwaitable(DataIngestion& ingestion, size_t queue, size_t max_records)
+        : ingestion_(ingestion), queue_(queue), max_records_(max_records)
+    {
+    }
+
+    DataIngestion& ingestion_;
+    size_t queue_;       // Shard index, or SIZE_MAX for the shared queue
+    size_t max_records_;
+    std::vector<std::shared_ptr<DataRecord>> batch_;
+};
+
 // DataIngestion Class
 class DataIngestion
 {
 public:
+    explicit DataIngestion(const IngestionConfig& config);
+
     // Modified constructor to accept multiple ingestion_thread_cores
     DataIngestion(const std::string& ip, int port, const std::vector<int>& ingestion_thread_cores = {2});
     ~DataIngestion();
@@ -91,16 +201,104 @@ public:
     void start();
     void stop();
 
+    bool is_running() const;
+
+    // Apply the runtime-tunable fields of config to the live pipeline. Ingest threads
+    // pick the new values up on their next loop iteration. Returns false (and keeps
+    // the current values) for any structural field that differs.
+    bool reload(const IngestionConfig& config);
+
+    // Shared queue consumer (sharding and shared-memory output disabled)
     bool get_data(std::shared_ptr<DataRecord>& record);
 
+    // Shard consumer (sharding enabled). Each shard must be drained by a single thread.
+    bool get_data(size_t shard, std::shared_ptr<DataRecord>& record);
+
+    // Awaitable consumers: co_await next_batch() from a coroutine run by a
+    // ConsumerExecutor instead of spinning on get_data(). The shard variant has the
+    // same single-consumer rule as get_data(shard, record).
+    RecordBatchAwaitable next_batch(size_t max_records = 256);
+    RecordBatchAwaitable next_shard_batch(size_t shard, size_t max_records = 256);
+
+    size_t num_shards() const;
+    ShardStats get_shard_stats() const;
+
+    // Return a consumed record to the pool. Pool watermarks only fall if consumers recycle.
+    void recycle(std::shared_ptr<DataRecord> record);
+
+    FlowControlStats get_flow_control_stats() const;
+
+    std::vector<ConnectionStats> get_connection_stats() const;
+
+    // Where hot-path memory lives; backing is Heap when memory.arena_bytes is 0
+    ArenaStats get_arena_stats() const;
+
+    // Records of one feed received in [from_ms, to_ms), oldest first, from its recent
+    // history (history.bytes_per_feed). Safe on any thread while ingestion runs, and never
+    // blocks it. Returns false when history is disabled or the feed is unknown.
+    bool get_history(uint32_t feed_id, uint64_t from_ms, uint64_t to_ms, std::vector<DataRecord>& records,
+                     size_t max_records = SIZE_MAX) const;
+
 private:
-    void ingest(int cpu_core);
+    friend struct FeedConnection;
+    friend class RecordBatchAwaitable;
+
+    void ingest(size_t thread_index, int cpu_core);
+    void refresh_tunables(IngestThreadState& state);
+    void open_listener(IngestThreadState& state, int cpu_core);
+    void accept_connections(IngestThreadState& state, FeedConnection& listener);
+    void open_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void open_datagram(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void complete_connect(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void mark_connected(FeedConnection& conn);
+    void fail_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void drop_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void schedule_reconnect(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void finish_connection(FeedConnection& conn);
+    bool pause_for_overload(IngestThreadState& state);
+    void drain_socket(IngestThreadState& state, FeedConnection& conn, char* buffer, uint64_t now_ms);
+    void drain_datagrams(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms);
+    void capture(IngestThreadState& state, FeedConnection& conn, uint64_t timestamp_ns, const char* data,
+                 size_t size);
+    void admit(IngestThreadState& state, uint64_t timestamp, uint32_t feed_id, std::string_view message,
+               std::vector<std::shared_ptr<DataRecord>>& batch);
+    void unspill(IngestThreadState& state);
+    void update_overload(IngestThreadState& state);
+    size_t queue_depth() const;
+    void publish(size_t thread_index, std::shared_ptr<DataRecord> record);
+    size_t take_batch(size_t queue, std::vector<std::shared_ptr<DataRecord>>& batch, size_t max_records);
+    bool park(RecordBatchAwaitable& awaiter, std::coroutine_handle<> handle);
+    void notify_consumers();
+    void wake_consumers();
 
-    std::string ip_;
-    int port_;
-    std::vector<int> ingestion_thread_cores_; // Store multiple cores
+    // Structural configuration, fixed at construction
+    IngestionConfig config_;
     std::atomic<bool> running_;
     std::vector<std::thread> ingest_threads_;
+    std::atomic<size_t> active_threads_{0}; // The last ingest thread to finish clears running_
+
+    // Per-feed counters, each written only by the ingest thread that owns the feed
+    struct FeedCounters
+    {
+        std::atomic<int> state{0};  // FeedConnection::State
+        std::atomic<size_t> address_index{0};
+        std::atomic<uint64_t> connects{0};
+        std::atomic<uint64_t> connect_failures{0};
+        std::atomic<uint64_t> disconnects{0};
+        std::atomic<uint64_t> failovers{0};
+        alignas(64) std::atomic<uint64_t> bytes_received{0};
+        std::atomic<uint64_t> records{0};
+        std::atomic<uint64_t> filtered{0};
+        std::atomic<uint64_t> datagrams{0};
+        std::atomic<uint64_t> bad_datagrams{0};
+        std::atomic<uint64_t> kernel_drops{0};
+    };
+    std::vector<std::unique_ptr<FeedCounters>> feed_counters_;
+    std::vector<std::unique_ptr<FeedCounters>> listener_counters_; // One per ingestion thread
+
+    // Hot-path memory when memory.arena_bytes is set; declared before everything carved
+    // from it. Shared with pooled records, which may outlive this object.
+    std::shared_ptr<Arena> arena_;
 
     // Lock-Free Queue for storing data
     LockFreeQueue<DataRecord> data_queue_;
@@ -108,15 +306,62 @@ private:
     // Lock-Free Memory Pool for DataRecord objects
     LockFreeMemoryPool<DataRecord> memory_pool_;
 
-    // epoll file descriptor
-    int epoll_fd_;
+    // Compiled from config_.filter; read-only and shared by every ingest thread
+    RecordFilter filter_;
+
+    // Recent history, each ring appended to only by the ingest thread owning the feed;
+    // the listener feed, served by every thread, gets one ring per thread
+    std::vector<std::unique_ptr<HistoryBuffer>> feed_history_;
+    std::vector<std::unique_ptr<HistoryBuffer>> listener_history_;
+
+    // One SPSC lane per (ingestion thread, shard) pair keeps every queue single-producer
+    // while preserving per-key order for keys arriving on the same thread.
+    struct ShardLane
+    {
+        ShardLane(size_t capacity, Arena* arena)
+            : queue(capacity, arena)
+        {
+        }
+
+        SpscQueue<std::shared_ptr<DataRecord>> queue;
+        alignas(64) std::atomic<uint64_t> routed{0}; // Written only by the owning ingest thread
+    };
 
-    // Socket file descriptor
-    int sock_fd_;
+    // Consumer-side cursor for a shard, touched only by that shard's consumer
+    struct alignas(64) ShardCursor
+    {
+        size_t next_lane = 0;
+    };
+
+    // Runtime-tunable configuration. reload() writes it under the mutex and bumps the
+    // generation; ingest threads copy it only when the generation changes.
+    std::mutex tunables_mutex_;
+    IngestionConfig tunables_;
+    std::atomic<uint64_t> tunables_generation_{0};
+
+    std::atomic<uint64_t> pauses_{0};
+    std::atomic<uint64_t> dropped_newest_{0};
+    std::atomic<uint64_t> dropped_oldest_{0};
+    std::atomic<uint64_t> spilled_{0};
+    std::atomic<uint64_t> unspilled_{0};
+
+    // Coroutines parked in next_batch(). parked_count_ lets producers skip the mutex
+    // while every consumer is busy.
+    struct ParkedConsumer
+    {
+        RecordBatchAwaitable* awaiter;
+        std::coroutine_handle<> handle;
+        ConsumerExecutor* executor; // nullptr: resume inline on the waking thread
+        size_t worker;
+    };
+    std::mutex parked_mutex_;
+    std::vector<ParkedConsumer> parked_;
+    std::atomic<size_t> parked_count_{0};
+    std::atomic<bool> input_finished_{false}; // Set once the last ingest thread has published everything
 
-    // Buffer size
-    static const int BUFFER_SIZE = 4096;
+    // Shared-memory output for consumer processes; replaces the queues when set
+    std::unique_ptr<ShmSegment> shm_;
 
-    // Preallocated buffer
-    char buffer_[BUFFER_SIZE] __attribute__((aligned(64)));
+    std::vector<std::vector<std::unique_ptr<ShardLane>>> shard_lanes_; // [thread][shard]
+    std::unique_ptr<ShardCursor[]> shard_cursors_;
 };
@@ -0,0 +1,47 @@
+// include/ingestion/datagram_socket.hpp
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "arena.hpp"
+#include "config.hpp"
+
+// UDP socket bound to host:port for recvmmsg, shared by DataIngestion and the
+// Pipeline transport. A multicast host is joined on interface. The socket allows
+// several receivers on the same group and port, asks for socket_rcvbuf (past
+// net.core.rmem_max with CAP_NET_ADMIN) and reports kernel drops through SO_RXQ_OVFL.
+// type_flags are or-ed into SOCK_DGRAM | SOCK_CLOEXEC. Failures are logged with label
+// and return -1.
+int open_datagram_socket(const std::string& host, int port, const std::string& interface, int socket_rcvbuf,
+                         int type_flags, const std::string& label);
+
+// recvmmsg scatter buffers for up to udp.batch datagrams of udp.max_datagram bytes
+struct DatagramBatch
+{
+    size_t max_datagram = 0;
+    std::vector<char, ArenaAllocator<char>> data;
+    std::vector<char> control;
+    std::vector<struct iovec> iov;
+    std::vector<struct mmsghdr> headers;
+
+    // Room for the SO_RXQ_OVFL drop counter
+    static constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(uint32_t));
+
+    // Allocates the buffers once; later calls keep them
+    void prepare(const UdpConfig& udp, const std::shared_ptr<Arena>& arena = nullptr);
+
+    // recvmmsg overwrites the lengths and flags, so reset them before every call
+    void rearm();
+
+    // Datagrams dropped since last_count according to the socket's SO_RXQ_OVFL counter
+    // carried by header (the kernel counts per socket); updates last_count
+    static uint32_t take_drops(const struct msghdr& header, uint32_t& last_count);
+};
@@ -0,0 +1,338 @@
+// include/ingestion/decoder.hpp
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "config.hpp"
+
+// Frame decoder policies
+// Each type splits one framing format out of a TCP byte stream. A frame cut by a recv
+// boundary is carried over in partial_ and completed by the next feed(), so no record
+// is lost or split. Pipeline takes one of these as a template argument so the framing
+// loop is inlined into its receive path; FrameDecoder picks one at runtime.
+//
+// feed() calls on_frame(std::string_view) for every complete frame; the view is only
+// valid during the call. on_frame returns false to stop decoding early. feed() returns
+// false on a protocol error (oversized frame).
+//
+// feed_datagram() decodes one self-contained datagram. Nothing is carried into the
+// next one: a trailing line without '\n' is still a record, while a truncated
+// length-prefixed frame is a protocol error.
+
+class StreamDecoderBase
+{
+public:
+    explicit StreamDecoderBase(size_t max_frame_size)
+        : max_frame_size_(max_frame_size)
+    {
+    }
+
+    void reset()
+    {
+        partial_.clear();
+    }
+
+    size_t buffered() const
+    {
+        return partial_.size();
+    }
+
+protected:
+    bool append_partial(const char* data, size_t size)
+    {
+        if (partial_.size() + size > max_frame_size_ + HEADER_SIZE)
+        {
+            partial_.clear();
+            return false;
+        }
+        partial_.append(data, size);
+        return true;
+    }
+
+    // Length prefix of LengthPrefixedDecoder; also the slack allowed in partial_
+    static const size_t HEADER_SIZE = 4;
+
+    size_t max_frame_size_;
+    std::string partial_;
+};
+
+// '\n'-terminated frames
+class LineDecoder : public StreamDecoderBase
+{
+public:
+    explicit LineDecoder(size_t max_frame_size = 1024 * 1024)
+        : StreamDecoderBase(max_frame_size)
+    {
+    }
+
+    template <typename OnFrame>
+    bool feed(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        const char* end = data + size;
+        const char* start = data;
+
+        if (!partial_.empty())
+        {
+            const char* newline = static_cast<const char*>(memchr(start, '\n', size));
+            if (newline == nullptr)
+            {
+                return append_partial(start, size);
+            }
+            partial_.append(start, newline - start);
+            bool keep_going = on_frame(std::string_view(partial_));
+            partial_.clear();
+            start = newline + 1;
+            if (!keep_going)
+            {
+                return true;
+            }
+        }
+
+        while (start < end)
+        {
+            const char* newline = static_cast<const char*>(memchr(start, '\n', end - start));
+            if (newline == nullptr)
+            {
+                return append_partial(start, end - start);
+            }
+            if (!on_frame(std::string_view(start, newline - start)))
+            {
+                return true;
+            }
+            start = newline + 1;
+        }
+        return true;
+    }
+
+    template <typename OnFrame>
+    bool feed_datagram(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        bool keep_going = true;
+        auto guarded = [&on_frame, &keep_going](std::string_view frame)
+        {
+            keep_going = on_frame(frame);
+            return keep_going;
+        };
+        bool ok = feed(data, size, guarded);
+        if (ok && keep_going && !partial_.empty())
+        {
+            on_frame(std::string_view(partial_));
+        }
+        partial_.clear();
+        return ok;
+    }
+};
+
+// Frames preceded by a 4-byte big-endian length
+class LengthPrefixedDecoder : public StreamDecoderBase
+{
+public:
+    explicit LengthPrefixedDecoder(size_t max_frame_size = 1024 * 1024)
+        : StreamDecoderBase(max_frame_size)
+    {
+    }
+
+    template <typename OnFrame>
+    bool feed(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        const char* end = data + size;
+        const char* start = data;
+
+        if (!partial_.empty())
+        {
+            // Complete the header first, then the payload, from the new bytes
+            size_t needed = HEADER_SIZE > partial_.size() ? HEADER_SIZE - partial_.size() : 0;
+            size_t take = needed < size ? needed : size;
+            partial_.append(start, take);
+            start += take;
+            if (partial_.size() < HEADER_SIZE)
+            {
+                return true;
+            }
+            size_t length = read_length(partial_.data());
+            if (length > max_frame_size_)
+            {
+                partial_.clear();
+                return false;
+            }
+            size_t missing = HEADER_SIZE + length - partial_.size();
+            take = missing < static_cast<size_t>(end - start) ? missing : static_cast<size_t>(end - start);
+            partial_.append(start, take);
+            start += take;
+            if (partial_.size() < HEADER_SIZE + length)
+            {
+                return true;
+            }
+            bool keep_going = on_frame(std::string_view(partial_.data() + HEADER_SIZE, length));
+            partial_.clear();
+            if (!keep_going)
+            {
+                return true;
+            }
+        }
+
+        while (static_cast<size_t>(end - start) >= HEADER_SIZE)
+        {
+            size_t length = read_length(start);
+            if (length > max_frame_size_)
+            {
+                return false;
+            }
+            if (static_cast<size_t>(end - start) < HEADER_SIZE + length)
+            {
+                break;
+            }
+            if (!on_frame(std::string_view(start + HEADER_SIZE, length)))
+            {
+                return true;
+            }
+            start += HEADER_SIZE + length;
+        }
+        return append_partial(start, end - start);
+    }
+
+    template <typename OnFrame>
+    bool feed_datagram(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        bool ok = feed(data, size, on_frame);
+        bool truncated = !partial_.empty();
+        partial_.clear();
+        return ok && !truncated;
+    }
+
+private:
+    static size_t read_length(const char* header)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(header);
+        return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+               (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+    }
+};
+
+// Every chunk or datagram is one frame
+class DatagramDecoder
+{
+public:
+    explicit DatagramDecoder(size_t max_frame_size = 1024 * 1024)
+        : max_frame_size_(max_frame_size)
+    {
+    }
+
+    template <typename OnFrame>
+    bool feed(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        on_frame(std::string_view(data, size));
+        return true;
+    }
+
+    template <typename OnFrame>
+    bool feed_datagram(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        if (size > max_frame_size_)
+        {
+            return false;
+        }
+        on_frame(std::string_view(data, size));
+        return true;
+    }
+
+    void reset()
+    {
+    }
+
+    size_t buffered() const
+    {
+        return 0;
+    }
+
+private:
+    size_t max_frame_size_;
+};
+
+// End-of-stream policies: the in-band message that ends a feed
+struct NoEndMarker
+{
+    static constexpr bool enabled = false;
+
+    static bool matches(std::string_view)
+    {
+        return false;
+    }
+};
+
+struct StopMessage
+{
+    static constexpr bool enabled = true;
+
+    static bool matches(std::string_view frame)
+    {
+        return frame.size() == 4 && memcmp(frame.data(), "STOP", 4) == 0;
+    }
+};
+
+// Stream Frame Decoder
+// Runtime choice between the decoder policies, for feeds whose framing comes from
+// configuration.
+class FrameDecoder
+{
+public:
+    FrameDecoder(DecoderType type = DecoderType::Line, size_t max_frame_size = 1024 * 1024)
+        : type_(type), line_(max_frame_size), length_prefixed_(max_frame_size), datagram_(max_frame_size)
+    {
+    }
+
+    template <typename OnFrame>
+    bool feed(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        switch (type_)
+        {
+        case DecoderType::Line:
+            return line_.feed(data, size, on_frame);
+        case DecoderType::LengthPrefixed:
+            return length_prefixed_.feed(data, size, on_frame);
+        default:
+            return datagram_.feed(data, size, on_frame);
+        }
+    }
+
+    template <typename OnFrame>
+    bool feed_datagram(const char* data, size_t size, OnFrame&& on_frame)
+    {
+        switch (type_)
+        {
+        case DecoderType::Line:
+            return line_.feed_datagram(data, size, on_frame);
+        case DecoderType::LengthPrefixed:
+            return length_prefixed_.feed_datagram(data, size, on_frame);
+        default:
+            return datagram_.feed_datagram(data, size, on_frame);
+        }
+    }
+
+    void reset()
+    {
+        line_.reset();
+        length_prefixed_.reset();
+    }
+
+    DecoderType type() const
+    {
+        return type_;
+    }
+
+    size_t buffered() const
+    {
+        return line_.buffered() + length_prefixed_.buffered();
+    }
+
+private:
+    DecoderType type_;
+    LineDecoder line_;
+    LengthPrefixedDecoder length_prefixed_;
+    DatagramDecoder datagram_;
+};
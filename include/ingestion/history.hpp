@@ -0,0 +1,99 @@
+// include/ingestion/history.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+
+struct DataRecord;
+
+// Recent-History Buffer
+// Bounded per-feed record history in one fixed-size byte ring. One writer (the
+// ingest thread owning the feed) appends in place and evicts the oldest records once the
+// ring is full. Readers on any thread scan a timestamp range without locks and without
+// slowing the writer: the writer advances tail_ before it overwrites anything, and a
+// reader that copied a record re-checks tail_ afterwards, discarding the copy if the
+// record was evicted meanwhile (the seqlock pattern). A sparse index of the record
+// starting in each INDEX_STRIDE block lets a scan binary-search its first record instead
+// of walking the ring. Timestamps are expected to be non-decreasing, as receive times
+// stamped by a single thread are.
+class HistoryBuffer
+{
+public:
+    // capacity_bytes is raised to at least INDEX_STRIDE and rounded down to the record
+    // alignment. The ring comes from arena when one is given.
+    explicit HistoryBuffer(size_t capacity_bytes, Arena* arena = nullptr);
+    ~HistoryBuffer();
+
+    HistoryBuffer(const HistoryBuffer&) = delete;
+    HistoryBuffer& operator=(const HistoryBuffer&) = delete;
+
+    // Writer only. Messages that cannot fit in the ring at all are skipped.
+    void append(uint64_t timestamp, uint32_t feed_id, std::string_view message);
+
+    // Any thread. Appends records with from_ms <= timestamp < to_ms to out, oldest first,
+    // stopping after max_records; returns how many were appended.
+    size_t range(uint64_t from_ms, uint64_t to_ms, std::vector<DataRecord>& out, size_t max_records = SIZE_MAX) const;
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    // Records appended so far, including those since evicted
+    uint64_t appended() const
+    {
+        return appended_.load(std::memory_order_relaxed);
+    }
+
+    // Messages larger than the ring
+    uint64_t skipped() const
+    {
+        return skipped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Header
+    {
+        uint64_t timestamp;
+        uint32_t feed_id;
+        uint32_t length;  // WRAP_MARKER: the rest of the ring is unused, continue at its start
+    };
+
+    static constexpr uint32_t WRAP_MARKER = UINT32_MAX;
+    static constexpr size_t ALIGNMENT = sizeof(Header);
+    static constexpr size_t INDEX_STRIDE = 4096;
+
+    static size_t record_size(size_t length)
+    {
+        return (sizeof(Header) + length + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void evict_until(uint64_t end);
+
+    // Copy the header at logical position pos; false if it was evicted during the copy
+    bool read_header(uint64_t pos, Header& header) const;
+
+    // Position of the first record that may be at or after from_ms
+    uint64_t seek(uint64_t from_ms, uint64_t tail) const;
+
+    size_t capacity_;
+    Arena* arena_;
+    uint64_t* ring_;  // uint64_t keeps headers aligned
+    size_t index_size_;
+    std::unique_ptr<std::atomic<uint64_t>[]> index_;  // Record positions, slot = entry % index_size_
+
+    // Logical byte positions grow forever; the ring offset is position % capacity_
+    alignas(64) std::atomic<uint64_t> head_{0};   // End of the last complete record
+    std::atomic<uint64_t> tail_{0};               // Start of the oldest record still held
+    std::atomic<uint64_t> index_count_{0};        // Index entries written so far
+    std::atomic<uint64_t> appended_{0};
+    std::atomic<uint64_t> skipped_{0};
+    uint64_t next_index_block_ = 0;               // Writer only
+};
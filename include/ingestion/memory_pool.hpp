@@ -4,52 +4,142 @@
 
 #include <memory>
 #include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include "arena.hpp"
+
+// Treiber stack of nodes linked through their std::atomic<Node*> next member. The head
+// carries a 16-bit tag in the unused pointer bits to defeat ABA. A popping thread may
+// read a node another thread just popped, so nodes must be recycled rather than freed
+// while the stack is in use.
+template <typename Node>
+class TaggedStack
+{
+public:
+    void push(Node* node)
+    {
+        uint64_t expected = head_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(unpack(expected), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(expected, pack(node, expected), std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    Node* pop()
+    {
+        uint64_t expected = head_.load(std::memory_order_acquire);
+        while (Node* node = unpack(expected))
+        {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(expected, pack(next, expected), std::memory_order_acquire,
+                                            std::memory_order_acquire))
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // Detach every node at once; only safe once no other thread uses the stack
+    Node* take_all()
+    {
+        return unpack(head_.exchange(0, std::memory_order_acquire));
+    }
+
+private:
+    static constexpr int TAG_SHIFT = 48;
+    static constexpr uint64_t POINTER_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+
+    static Node* unpack(uint64_t word)
+    {
+        return reinterpret_cast<Node*>(word & POINTER_MASK);
+    }
+
+    static uint64_t pack(Node* node, uint64_t previous)
+    {
+        uint64_t tag = (previous >> TAG_SHIFT) + 1;
+        return (tag << TAG_SHIFT) | reinterpret_cast<uint64_t>(node);
+    }
+
+    std::atomic<uint64_t> head_{0};
+};
 
 // Lock-Free Memory Pool Implementation
+// Free objects live on a TaggedStack. Stack nodes are recycled through a second
+// stack instead of being deleted, so a popping thread never touches freed memory.
+// With an arena, objects (with their shared_ptr control blocks) and stack nodes are
+// carved from it, so the pool is contiguous and on huge pages.
 template <typename T>
 class LockFreeMemoryPool
 {
 public:
-    LockFreeMemoryPool(size_t pool_size = 10000)
+    // max_size == 0 keeps the legacy behaviour of expanding without bound
+    LockFreeMemoryPool(size_t pool_size = 10000, size_t max_size = 0, std::shared_ptr<Arena> arena = nullptr)
+        : pool_size_(pool_size), max_size_(max_size), arena_(std::move(arena))
     {
         expand_pool(pool_size);
     }
 
+    // Returns nullptr once max_size objects are outstanding
     std::shared_ptr<T> acquire()
     {
-        Node* old_head = head_.load(std::memory_order_acquire);
-        while (old_head != nullptr)
+        while (true)
         {
-            Node* next = old_head->next.load(std::memory_order_acquire);
-            if (head_.compare_exchange_weak(old_head, next, std::memory_order_release, std::memory_order_relaxed))
+            Node* node = free_.pop();
+            if (node != nullptr)
+            {
+                available_.fetch_sub(1, std::memory_order_relaxed);
+                std::shared_ptr<T> ptr = std::move(node->data);
+                spare_.push(node);
+                return ptr;
+            }
+            // Pool exhausted, expand within the configured bound
+            if (!expand_pool(pool_size_))
             {
-                return old_head->data;
+                return nullptr;
             }
         }
-        // Pool exhausted, expand
-        expand_pool(pool_size_);
-        return acquire();
     }
 
     void release(std::shared_ptr<T> ptr)
     {
-        Node* new_node = new Node(ptr);
-        new_node->next.store(head_.load(std::memory_order_relaxed), std::memory_order_relaxed);
-        Node* expected = new_node->next.load(std::memory_order_relaxed);
-        while (!head_.compare_exchange_weak(expected, new_node, std::memory_order_release, std::memory_order_relaxed))
+        Node* node = spare_.pop();
+        if (node == nullptr)
         {
-            new_node->next.store(expected, std::memory_order_relaxed);
+            node = arena_new<Node>(arena_.get());
         }
+        node->data = std::move(ptr);
+        free_.push(node);
+        available_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Objects created by the pool so far
+    size_t capacity() const
+    {
+        return total_.load(std::memory_order_relaxed);
+    }
+
+    // Objects currently handed out and not yet released
+    size_t in_use() const
+    {
+        size_t total = total_.load(std::memory_order_relaxed);
+        size_t available = available_.load(std::memory_order_relaxed);
+        return total > available ? total - available : 0;
     }
 
     ~LockFreeMemoryPool()
     {
-        Node* current = head_.load(std::memory_order_relaxed);
-        while (current != nullptr)
+        for (TaggedStack<Node>* stack : {&free_, &spare_})
         {
-            Node* next = current->next.load(std::memory_order_relaxed);
-            delete current;
-            current = next;
+            Node* current = stack->take_all();
+            while (current != nullptr)
+            {
+                Node* next = current->next.load(std::memory_order_relaxed);
+                arena_delete(arena_.get(), current);
+                current = next;
+            }
         }
     }
 
@@ -57,23 +147,41 @@ private:
     struct Node
     {
         std::shared_ptr<T> data;
-        std::atomic<Node*> next;
-
-        Node(std::shared_ptr<T> ptr)
-            : data(ptr), next(nullptr)
-        {
-        }
+        std::atomic<Node*> next{nullptr};
     };
 
-    void expand_pool(size_t count)
+    bool expand_pool(size_t count)
     {
+        // Reserve the growth up front so concurrent expanders cannot overshoot max_size_
+        size_t total = total_.load(std::memory_order_relaxed);
+        do
+        {
+            if (max_size_ != 0)
+            {
+                if (total >= max_size_)
+                {
+                    return false;
+                }
+                count = std::min(count, max_size_ - total);
+            }
+            if (count == 0)
+            {
+                return false;
+            }
+        } while (!total_.compare_exchange_weak(total, total + count, std::memory_order_relaxed));
+
         for (size_t i = 0; i < count; ++i)
         {
-            auto ptr = std::make_shared<T>();
-            release(ptr);
+            release(std::allocate_shared<T>(ArenaAllocator<T>(arena_)));
         }
+        return true;
     }
 
-    std::atomic<Node*> head_{nullptr};
+    TaggedStack<Node> free_;
+    TaggedStack<Node> spare_;
+    std::atomic<size_t> total_{0};
+    std::atomic<size_t> available_{0};
     size_t pool_size_ = 10000;
+    size_t max_size_ = 0;
+    std::shared_ptr<Arena> arena_;
 };
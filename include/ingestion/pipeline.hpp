@@ -0,0 +1,419 @@
+// include/ingestion/pipeline.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include "decoder.hpp"
+#include "shm_ring.hpp"
+#include "timestamper.hpp"
+
+// Compile-Time Configured Pipeline
+// Pipeline<Transport, Decoder, Timestamper, Queue, Sink> runs one feed's
+// receive -> frame -> stamp -> enqueue path with every stage fixed at compile time, so
+// the compiler inlines the whole loop for that feed type: no decoder switch, no
+// shared_ptr unless the queue policy wants one, and the end-of-stream check disappears
+// when EndOfStream is NoEndMarker.
+//
+// DataIngestion is not an instantiation: it multiplexes many feeds on epoll with flow
+// control and reload, and shares only the decoder policies (through FrameDecoder),
+// SystemClockMs and StopMessage with this template. Pipeline is for a single feed whose
+// type is known at build time; ingestion_benchmark's pipeline mode is one.
+//
+// Stage requirements:
+//   Transport:   static constexpr bool datagram; bool open(); void close();
+//                ReceiveStatus receive(on_chunk(const char*, size_t))
+//   Decoder:     feed() / feed_datagram() as in decoder.hpp
+//   Timestamper: static uint64_t now()
+//   Queue:       bool open(); bool push(const RecordView&, Sink&); void flush();
+//                size_t drain(Sink&, size_t max); void finish(); size_t size() const
+//   Sink:        void operator()(const RecordView&)
+//   EndOfStream: static constexpr bool enabled; static bool matches(std::string_view)
+
+// A decoded record; message points into a receive buffer or a queue slot and is only
+// valid during the sink call
+struct RecordView
+{
+    uint64_t timestamp;
+    uint32_t feed_id;
+    std::string_view message;
+};
+
+enum class ReceiveStatus
+{
+    Data,    // on_chunk was called at least once
+    Idle,    // Nothing arrived within the receive timeout
+    Closed   // Peer closed or the socket failed
+};
+
+// Transports
+
+// Outbound TCP connection with a blocking, timed recv into one buffer
+class TcpTransport
+{
+public:
+    static constexpr bool datagram = false;
+
+    TcpTransport(std::string host, int port, size_t buffer_size = 65536, int socket_rcvbuf = 8 * 1024 * 1024);
+    ~TcpTransport();
+
+    TcpTransport(TcpTransport&& other) noexcept;
+    TcpTransport(const TcpTransport&) = delete;
+    TcpTransport& operator=(const TcpTransport&) = delete;
+
+    bool open();
+    void close();
+
+    template <typename OnChunk>
+    ReceiveStatus receive(OnChunk&& on_chunk)
+    {
+        ssize_t count = recv(fd_, buffer_.data(), buffer_.size(), 0);
+        if (count > 0)
+        {
+            on_chunk(buffer_.data(), static_cast<size_t>(count));
+            return ReceiveStatus::Data;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            return ReceiveStatus::Idle;
+        }
+        if (count < 0)
+        {
+            std::cerr << "Pipeline " << host_ << ":" << port_ << ": recv error: " << strerror(errno) << "\n";
+        }
+        return ReceiveStatus::Closed;
+    }
+
+private:
+    std::string host_;
+    int port_;
+    int socket_rcvbuf_;
+    int fd_ = -1;
+    std::vector<char> buffer_;
+};
+
+// Queues
+// push() returns false when the queue is momentarily full; the pipeline then flushes
+// and retries, which stops it reading its socket (back-pressure) until there is room.
+
+// Single-producer single-consumer byte ring holding records in place, laid out like
+// the shared-memory rings: [length:u32][feed_id:u32][timestamp:u64][payload, padded
+// to 8]. No allocation per record; pushes become visible to the consumer on flush().
+class SpscRecordRing
+{
+public:
+    explicit SpscRecordRing(size_t ring_bytes = 16 * 1024 * 1024)
+    {
+        capacity_ = 64;
+        while (capacity_ < ring_bytes)
+        {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        words_.reset(new uint64_t[capacity_ / sizeof(uint64_t)]);
+        data_ = reinterpret_cast<char*>(words_.get());
+    }
+
+    SpscRecordRing(const SpscRecordRing&) = delete;
+    SpscRecordRing& operator=(const SpscRecordRing&) = delete;
+
+    bool open()
+    {
+        return true;
+    }
+
+    template <typename Sink>
+    bool push(const RecordView& record, Sink&)
+    {
+        const uint64_t length = record.message.size();
+        const uint64_t needed = sizeof(ShmRecordHeader) + ((length + 7) & ~uint64_t(7));
+        if (needed > capacity_ / 2)
+        {
+            ++oversized_; // Could never fit beside a wrap; dropped
+            return true;
+        }
+        uint64_t offset = pending_ & mask_;
+        uint64_t skip = offset + needed > capacity_ ? capacity_ - offset : 0;
+        if (pending_ + skip + needed - cached_head_ > capacity_)
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (pending_ + skip + needed - cached_head_ > capacity_)
+            {
+                return false;
+            }
+        }
+        if (skip > 0)
+        {
+            memcpy(data_ + offset, &SHM_WRAP_MARKER, sizeof(SHM_WRAP_MARKER));
+            pending_ += skip;
+            offset = 0;
+        }
+        ShmRecordHeader header{static_cast<uint32_t>(length), record.feed_id, record.timestamp};
+        memcpy(data_ + offset, &header, sizeof(header));
+        memcpy(data_ + offset + sizeof(header), record.message.data(), length);
+        pending_ += needed;
+        return true;
+    }
+
+    void flush()
+    {
+        tail_.store(pending_, std::memory_order_release);
+    }
+
+    template <typename Sink>
+    size_t drain(Sink& sink, size_t max_records)
+    {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        const uint64_t tail = tail_.load(std::memory_order_acquire);
+        size_t delivered = 0;
+        while (head < tail && delivered < max_records)
+        {
+            uint64_t offset = head & mask_;
+            ShmRecordHeader header;
+            memcpy(&header, data_ + offset, sizeof(header.length));
+            if (header.length == SHM_WRAP_MARKER)
+            {
+                head += capacity_ - offset;
+                continue;
+            }
+            memcpy(&header, data_ + offset, sizeof(header));
+            sink(RecordView{header.timestamp, header.feed_id,
+                            std::string_view(data_ + offset + sizeof(header), header.length)});
+            head += sizeof(header) + ((uint64_t(header.length) + 7) & ~uint64_t(7));
+            ++delivered;
+        }
+        head_.store(head, std::memory_order_release);
+        return delivered;
+    }
+
+    void finish()
+    {
+        flush();
+    }
+
+    // Bytes published and not yet consumed
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    uint64_t oversized() const
+    {
+        return oversized_;
+    }
+
+private:
+    // Consumer-owned line
+    alignas(64) std::atomic<uint64_t> head_{0};
+
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    uint64_t pending_ = 0;
+    uint64_t cached_head_ = 0;
+    uint64_t oversized_ = 0;
+
+    // Read-only after construction
+    alignas(64) std::unique_ptr<uint64_t[]> words_;
+    char* data_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t mask_ = 0;
+};
+
+// Pipeline counters, written by the receiving thread; read them after run() returns
+struct PipelineStats
+{
+    uint64_t bytes_received = 0;
+    uint64_t records = 0;
+    uint64_t protocol_errors = 0;  // Oversized stream frames, undecodable datagrams
+    uint64_t full_waits = 0;       // Times a push found the queue full and the pipeline stalled
+    uint64_t dropped = 0;          // Records abandoned because stop() came while stalled
+};
+
+template <typename TransportT, typename DecoderT, typename TimestamperT, typename QueueT, typename SinkT,
+          typename EndOfStreamT = NoEndMarker>
+class Pipeline
+{
+public:
+    template <typename... QueueArgs>
+    Pipeline(uint32_t feed_id, TransportT transport, DecoderT decoder, SinkT sink, QueueArgs&&... queue_args)
+        : feed_id_(feed_id),
+          transport_(std::move(transport)),
+          decoder_(std::move(decoder)),
+          queue_(std::forward<QueueArgs>(queue_args)...),
+          sink_(std::move(sink))
+    {
+    }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // Receiving thread. Pumps until the peer closes, the end-of-stream message arrives,
+    // stop() is called, or a stream frame is malformed. Returns false if the pipeline
+    // could not start or the stream was malformed.
+    bool run()
+    {
+        bool ok = queue_.open() && transport_.open();
+        while (ok && running_.load(std::memory_order_relaxed) && !end_of_stream_)
+        {
+            ReceiveStatus status = transport_.receive([this](const char* data, size_t size)
+            {
+                receive_chunk(data, size);
+            });
+            queue_.flush();
+            if (status == ReceiveStatus::Closed)
+            {
+                break;
+            }
+            if (malformed_)
+            {
+                std::cerr << "Pipeline feed " << feed_id_ << ": frame exceeds max_frame_size; closing\n";
+                ok = false;
+            }
+        }
+        transport_.close();
+        queue_.finish();
+        finished_.store(true, std::memory_order_release);
+        return ok;
+    }
+
+    // Ask run() to return; safe from any thread
+    void stop()
+    {
+        running_.store(false, std::memory_order_relaxed);
+    }
+
+    // run() has returned; everything it accepted is in the queue
+    bool finished() const
+    {
+        return finished_.load(std::memory_order_acquire);
+    }
+
+    // Consumer thread: hand up to max_records queued records to the sink
+    size_t poll(size_t max_records = SIZE_MAX)
+    {
+        return queue_.drain(sink_, max_records);
+    }
+
+    // Consumer thread: poll until run() has returned and the queue is empty
+    void consume()
+    {
+        while (true)
+        {
+            bool done = finished();
+            if (poll() == 0)
+            {
+                if (done)
+                {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    const PipelineStats& stats() const
+    {
+        return stats_;
+    }
+
+    TransportT& transport()
+    {
+        return transport_;
+    }
+
+    QueueT& queue()
+    {
+        return queue_;
+    }
+
+    SinkT& sink()
+    {
+        return sink_;
+    }
+
+private:
+    void receive_chunk(const char* data, size_t size)
+    {
+        const uint64_t timestamp = TimestamperT::now();
+        stats_.bytes_received += size;
+        auto on_frame = [this, timestamp](std::string_view frame)
+        {
+            return admit(timestamp, frame);
+        };
+        if constexpr (TransportT::datagram)
+        {
+            if (!decoder_.feed_datagram(data, size, on_frame))
+            {
+                ++stats_.protocol_errors;
+            }
+        }
+        else
+        {
+            if (!decoder_.feed(data, size, on_frame))
+            {
+                ++stats_.protocol_errors;
+                malformed_ = true;
+            }
+        }
+    }
+
+    bool admit(uint64_t timestamp, std::string_view frame)
+    {
+        if constexpr (EndOfStreamT::enabled)
+        {
+            if (EndOfStreamT::matches(frame))
+            {
+                end_of_stream_ = true;
+                return false;
+            }
+        }
+        ++stats_.records;
+        RecordView record{timestamp, feed_id_, frame};
+        if (!queue_.push(record, sink_)) [[unlikely]]
+        {
+            wait_for_room(record);
+        }
+        return true;
+    }
+
+    void wait_for_room(const RecordView& record)
+    {
+        ++stats_.full_waits;
+        queue_.flush(); // The consumer may be waiting on what is staged
+        while (!queue_.push(record, sink_))
+        {
+            if (!running_.load(std::memory_order_relaxed))
+            {
+                ++stats_.dropped;
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    uint32_t feed_id_;
+    TransportT transport_;
+    DecoderT decoder_;
+    QueueT queue_;
+    SinkT sink_;
+    PipelineStats stats_;
+    bool end_of_stream_ = false;
+    bool malformed_ = false;
+    std::atomic<bool> running_{true};
+    std::atomic<bool> finished_{false};
+};
+
@@ -0,0 +1,93 @@
+// include/ingestion/record_filter.hpp
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "config.hpp"
+
+// Multi-Substring Matcher
+// Teddy-style: patterns are sorted into up to 8 buckets, and the first 1-3 bytes of
+// every pattern (its fingerprint) are compiled into nibble tables mapping a byte at a
+// given fingerprint position to the buckets that allow it there. With SSSE3, two
+// PSHUFB lookups per fingerprint byte test 16 start positions at once; only positions
+// whose bucket mask survives every fingerprint byte are verified with memcmp. Without
+// SSSE3 the same tables are probed one position at a time.
+class MultiSubstringMatcher
+{
+public:
+    // Replaces any previous patterns; empty patterns are ignored
+    void compile(const std::vector<std::string>& patterns);
+
+    bool empty() const
+    {
+        return patterns_.empty();
+    }
+
+    // True if any pattern occurs in data
+    bool find(const char* data, size_t size) const
+    {
+        return size >= min_length_ && (this->*search_)(data, size);
+    }
+
+    // "ssse3" or "scalar"
+    const char* engine() const;
+
+private:
+    static const size_t BUCKETS = 8;
+    static const size_t MAX_FINGERPRINT = 3;
+
+    bool find_scalar(const char* data, size_t size) const;
+    bool find_ssse3(const char* data, size_t size) const;
+    bool scan_scalar(const char* data, size_t size, size_t from) const;
+    bool verify(const char* data, size_t size, size_t pos, uint8_t buckets) const;
+
+    std::vector<std::string> patterns_;
+    std::vector<uint16_t> buckets_[BUCKETS];   // Pattern indexes per bucket
+    size_t fingerprint_ = 0;
+    size_t min_length_ = 1;
+    alignas(16) uint8_t low_nibbles_[MAX_FINGERPRINT][16] = {};
+    alignas(16) uint8_t high_nibbles_[MAX_FINGERPRINT][16] = {};
+    bool (MultiSubstringMatcher::*search_)(const char*, size_t) const = &MultiSubstringMatcher::find_scalar;
+};
+
+// Record Filter
+// Compiled once from FilterConfig and then only read, so every ingest thread can share
+// one instance. Prefix and field patterns are checked first since they are cheapest.
+class RecordFilter
+{
+public:
+    void compile(const FilterConfig& config);
+
+    bool enabled() const
+    {
+        return enabled_;
+    }
+
+    // True when the frame should be ingested
+    bool accept(std::string_view frame) const
+    {
+        return !enabled_ || matches(frame) == keep_matching_;
+    }
+
+    // True when any pattern matches the frame
+    bool matches(std::string_view frame) const;
+
+    const char* engine() const
+    {
+        return substrings_.engine();
+    }
+
+private:
+    bool enabled_ = false;
+    bool keep_matching_ = true;
+    char delimiter_ = ',';
+    std::vector<std::string> prefixes_;
+    std::vector<std::pair<size_t, std::string>> fields_;
+    MultiSubstringMatcher substrings_;
+};
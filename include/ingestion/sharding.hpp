@@ -0,0 +1,56 @@
+// include/ingestion/sharding.hpp
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Extract the routing key from a frame: the key_field-th field separated by delimiter.
+// Frames with fewer fields fall back to the whole frame so they still route stably.
+inline std::string_view extract_shard_key(std::string_view frame, char delimiter, size_t key_field)
+{
+    size_t start = 0;
+    for (size_t field = 0; field < key_field; ++field)
+    {
+        size_t pos = frame.find(delimiter, start);
+        if (pos == std::string_view::npos)
+        {
+            return frame;
+        }
+        start = pos + 1;
+    }
+    size_t end = frame.find(delimiter, start);
+    if (end == std::string_view::npos)
+    {
+        end = frame.size();
+    }
+    return frame.substr(start, end - start);
+}
+
+// FNV-1a, 64-bit. Cheap on short keys and stable across runs.
+inline uint64_t hash_shard_key(std::string_view key)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Map a 64-bit hash onto [0, num_shards) without a division.
+inline size_t shard_for_hash(uint64_t hash, size_t num_shards)
+{
+    return static_cast<size_t>((static_cast<unsigned __int128>(hash) * num_shards) >> 64);
+}
+
+// Shard Skew Statistics
+struct ShardStats
+{
+    std::vector<uint64_t> routed;  // Records routed to each shard since start()
+    std::vector<size_t> depth;     // Records currently queued in each shard
+    double skew = 1.0;             // max(routed) / mean(routed); 1.0 is perfectly balanced
+};
@@ -0,0 +1,238 @@
+// include/ingestion/shm_ring.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Shared-Memory Record Rings
+// A named POSIX shared-memory segment holds one byte ring per ingestion thread. Each
+// ring has a single writer (its ingest thread) and up to SHM_MAX_READERS independent
+// reader cursors, one per attached consumer process. The writer never overwrites bytes
+// an attached reader has not consumed yet: when the slowest reader is a full ring
+// behind, new records are dropped and counted. Readers see records in place, without
+// copying, and sleep on a futex in the segment header when every ring is empty.
+//
+// Ring record layout, 8-byte aligned:
+//   [length:u32][feed_id:u32][timestamp:u64][payload, padded to 8]
+// A length of SHM_WRAP_MARKER means the rest of the ring is unused; continue at offset 0.
+
+const uint64_t SHM_MAGIC = 0x474e495254534e49ULL; // "INGSTRNG"
+const uint32_t SHM_VERSION = 1;
+const size_t SHM_MAX_READERS = 64;
+const uint32_t SHM_WRAP_MARKER = 0xffffffffu;
+
+struct ShmRecordHeader
+{
+    uint32_t length;
+    uint32_t feed_id;
+    uint64_t timestamp;
+};
+
+// Attached consumer, shared by all rings of a segment
+struct alignas(64) ShmReaderSlot
+{
+    std::atomic<int32_t> pid;     // 0 when free
+    std::atomic<uint32_t> active; // Cursors initialised; the writer must respect them
+};
+
+// One reader's position in one ring, written only by that reader
+struct alignas(64) ShmCursor
+{
+    std::atomic<uint64_t> read_pos;
+    std::atomic<uint64_t> records_read;
+};
+
+struct ShmRingHeader
+{
+    alignas(64) std::atomic<uint64_t> write_pos;       // Bytes committed, monotonic
+    std::atomic<uint64_t> records_written;
+    std::atomic<uint64_t> dropped;                     // Records rejected because the ring was full
+    ShmCursor cursors[SHM_MAX_READERS];
+};
+
+struct ShmSegmentHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t ring_count;
+    uint64_t ring_bytes;        // Data bytes per ring, a power of two
+    uint64_t ring_stride;       // Distance between consecutive ring headers
+    uint32_t max_readers;
+    alignas(64) std::atomic<uint32_t> futex;   // Bumped on every commit
+    std::atomic<uint32_t> waiters;             // Readers sleeping on futex
+    std::atomic<uint32_t> closed;              // Writer has finished; drain and detach
+    ShmReaderSlot readers[SHM_MAX_READERS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+// Mapping of a segment, created by the writer or attached by a reader
+class ShmSegment
+{
+public:
+    ShmSegment() = default;
+    ~ShmSegment();
+
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+
+    // Create (replacing any stale segment of the same name) and map it. ring_bytes is
+    // rounded up to a power of two.
+    bool create(const std::string& name, size_t ring_count, size_t ring_bytes, size_t max_readers);
+
+    // Map an existing segment created by another process
+    bool attach(const std::string& name);
+
+    // Unmap; the creator also removes the name
+    void close();
+
+    // Mark the stream finished and wake all readers (creator only)
+    void mark_closed();
+
+    // Wake readers sleeping in wait()
+    void notify();
+
+    // Sleep until notify(), the timeout, or a signal. seen is a futex value read
+    // before checking the rings, so a commit in between is never missed.
+    void wait(uint32_t seen, int timeout_ms);
+
+    ShmSegmentHeader* header() const
+    {
+        return header_;
+    }
+
+    ShmRingHeader* ring(size_t index) const
+    {
+        return reinterpret_cast<ShmRingHeader*>(base_ + ring_offset(index));
+    }
+
+    char* ring_data(size_t index) const
+    {
+        return base_ + ring_offset(index) + data_offset();
+    }
+
+private:
+    size_t ring_offset(size_t index) const;
+    static size_t data_offset();
+
+    std::string name_;
+    bool owner_ = false;
+    char* base_ = nullptr;
+    size_t size_ = 0;
+    ShmSegmentHeader* header_ = nullptr;
+};
+
+// Single-writer side of one ring, used by its ingest thread. Appends are staged and
+// become visible to readers together on commit().
+class ShmRingWriter
+{
+public:
+    ShmRingWriter(ShmSegment& segment, size_t ring_index);
+
+    // False (and counted in ShmRingHeader::dropped) when the slowest reader has no room left
+    bool append(uint64_t timestamp, uint32_t feed_id, std::string_view message);
+
+    // Publish staged records and wake sleeping readers
+    void commit();
+
+    // Records committed to a ring but not yet consumed by its slowest attached reader
+    static uint64_t backlog(const ShmSegment& segment, size_t ring_index);
+
+private:
+    uint64_t slowest_reader(bool reclaim_dead) const;
+
+    ShmSegment& segment_;
+    ShmSegmentHeader* header_;
+    ShmRingHeader* ring_;
+    char* data_;
+    uint64_t mask_;
+    uint64_t pending_pos_;      // Write position including staged records
+    uint64_t pending_records_;
+    uint64_t limit_;            // Cached slowest reader position + ring size
+};
+
+// A consumer attached to every ring of a segment. Records are delivered as views into
+// shared memory that stay valid until the callback returns.
+class ShmRingReader
+{
+public:
+    ShmRingReader() = default;
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // Attach and claim a reader slot; reading starts at the current end of every ring
+    bool open(const std::string& name);
+    void close();
+
+    // Call on_record(feed_id, timestamp, std::string_view) for up to max_records
+    // records, visiting the rings round-robin. Returns the number delivered.
+    template <typename OnRecord>
+    size_t poll(OnRecord&& on_record, size_t max_records = SIZE_MAX)
+    {
+        size_t delivered = 0;
+        const ShmSegmentHeader* header = segment_.header();
+        for (size_t visited = 0; visited < header->ring_count && delivered < max_records; ++visited)
+        {
+            size_t index = next_ring_;
+            next_ring_ = (next_ring_ + 1) % header->ring_count;
+            ShmRingHeader* ring = segment_.ring(index);
+            const char* data = segment_.ring_data(index);
+            const uint64_t mask = header->ring_bytes - 1;
+            ShmCursor& cursor = ring->cursors[slot_];
+
+            uint64_t read_pos = cursor.read_pos.load(std::memory_order_relaxed);
+            const uint64_t write_pos = ring->write_pos.load(std::memory_order_acquire);
+            uint64_t records = 0;
+            while (read_pos < write_pos && delivered < max_records)
+            {
+                uint64_t offset = read_pos & mask;
+                ShmRecordHeader record;
+                memcpy(&record, data + offset, sizeof(record.length));
+                if (record.length == SHM_WRAP_MARKER)
+                {
+                    read_pos += header->ring_bytes - offset;
+                    continue;
+                }
+                memcpy(&record, data + offset, sizeof(record));
+                on_record(record.feed_id, record.timestamp,
+                          std::string_view(data + offset + sizeof(record), record.length));
+                read_pos += sizeof(record) + ((record.length + 7) & ~uint64_t(7));
+                ++records;
+                ++delivered;
+            }
+            if (records > 0)
+            {
+                // Releasing the cursor hands the bytes back to the writer
+                cursor.records_read.store(cursor.records_read.load(std::memory_order_relaxed) + records,
+                                          std::memory_order_relaxed);
+                cursor.read_pos.store(read_pos, std::memory_order_release);
+            }
+        }
+        return delivered;
+    }
+
+    // Block until records may be available, the writer closes, or timeout_ms passes
+    void wait(int timeout_ms);
+
+    // The writer has finished and every ring is drained
+    bool finished() const;
+
+    // Records the writer dropped because some reader fell a full ring behind
+    uint64_t dropped() const;
+
+private:
+    bool has_data() const;
+
+    ShmSegment segment_;
+    size_t slot_ = 0;
+    size_t next_ring_ = 0;
+    bool attached_ = false;
+};
@@ -0,0 +1,49 @@
+// include/ingestion/spill_file.hpp
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Append-only overflow file owned by a single ingest thread.
+// Records are written as [timestamp:u64][feed_id:u32][length:u32][bytes] and read back in FIFO
+// order; the file is truncated whenever the reader catches up with the writer.
+class SpillFile
+{
+public:
+    SpillFile() = default;
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool append(uint64_t timestamp, uint32_t feed_id, std::string_view message);
+    bool read_next(uint64_t& timestamp, uint32_t& feed_id, std::string& message);
+
+    bool empty() const
+    {
+        return pending_ == 0;
+    }
+
+    uint64_t pending() const
+    {
+        return pending_;
+    }
+
+private:
+    bool flush();
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t read_offset_ = 0;
+    uint64_t write_offset_ = 0; // Bytes already handed to the kernel
+    uint64_t pending_ = 0;      // Records written but not yet read back
+    std::vector<char> write_buffer_;
+
+    static const size_t WRITE_BUFFER_SIZE = 64 * 1024;
+};
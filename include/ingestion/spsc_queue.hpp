@@ -0,0 +1,102 @@
+// include/ingestion/spsc_queue.hpp
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "arena.hpp"
+
+// Bounded Single-Producer Single-Consumer Ring Buffer
+// Capacity is rounded up to a power of two. Producer and consumer indices live on
+// separate cache lines and each side caches the other's index to avoid re-reading
+// the shared line on every operation. Slots come from the arena when one is given.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity = 65536, Arena* arena = nullptr)
+        : arena_(arena)
+    {
+        capacity_ = 1;
+        while (capacity_ < capacity)
+        {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        slots_ = arena_new_array<T>(arena_, capacity_);
+    }
+
+    ~SpscQueue()
+    {
+        arena_delete_array(arena_, slots_, capacity_);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool try_enqueue(T value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_)
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity_)
+            {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool try_dequeue(T& result)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_)
+        {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_)
+            {
+                return false;
+            }
+        }
+        result = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate depth; exact when called from either endpoint thread.
+    size_t size() const
+    {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    // Consumer-owned line
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // Producer-owned line
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    // Read-only after construction
+    alignas(64) T* slots_ = nullptr;
+    Arena* arena_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+};
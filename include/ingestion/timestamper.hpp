@@ -0,0 +1,75 @@
+// include/ingestion/timestamper.hpp
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timestamper policies
+// now() stamps one received chunk; every frame decoded from it shares the value.
+
+// Wall-clock milliseconds since the epoch, as stored in DataRecord::timestamp
+struct SystemClockMs
+{
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count()
+        );
+    }
+};
+
+// Wall-clock nanoseconds since the epoch, as stored in capture files
+struct SystemClockNs
+{
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count()
+        );
+    }
+};
+
+// Monotonic nanoseconds, for latency measurement within one host
+struct SteadyClockNs
+{
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count()
+        );
+    }
+};
+
+// Raw time-stamp counter cycles; cheapest, but needs an invariant TSC to be
+// comparable across cores. Falls back to SteadyClockNs elsewhere.
+struct CycleCounter
+{
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return SteadyClockNs::now();
+#endif
+    }
+};
+
+// No timestamps; the clock read compiles away
+struct NoTimestamp
+{
+    static uint64_t now()
+    {
+        return 0;
+    }
+};
@@ -1,14 +1,22 @@
 // mock_server/mock_server.cpp
 
+#include "ingestion/capture_file.hpp"
+
 #include <arpa/inet.h>
 #include <cstring>
 #include <iostream>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <thread>
 #include <chrono>
 #include <netinet/tcp.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
 
 // Function to set socket options for performance
 bool set_socket_options(int sockfd)
@@ -30,67 +38,135 @@ bool set_socket_options(int sockfd)
     return true;
 }
 
-void mock_server(int port, int num_messages, int interval_us, const std::string& stop_message = "STOP")
+// Dial host:port instead of listening, to exercise the ingestion listener
+int connect_to_listener(const std::string& host, int port)
 {
-    int server_fd, new_socket;
     struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-
-    // Create socket file descriptor
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0)
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) <= 0)
     {
-        std::cerr << "Socket failed\n";
-        return;
+        std::cerr << "Invalid address " << host << "\n";
+        return -1;
     }
 
-    // Attach socket to the port
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)))
+    // The ingestion side may still be starting up
+    for (int attempt = 0; attempt < 50; ++attempt)
     {
-        std::cerr << "setsockopt failed\n";
-        close(server_fd);
-        return;
+        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0)
+        {
+            std::cerr << "Socket failed\n";
+            return -1;
+        }
+        if (connect(sockfd, (struct sockaddr*)&address, sizeof(address)) == 0)
+        {
+            std::cout << "Mock server connected to " << host << ":" << port << std::endl;
+            return sockfd;
+        }
+        close(sockfd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    std::cerr << "Connect to " << host << ":" << port << " failed\n";
+    return -1;
+}
 
-    // Initialize address struct
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY; // Listen on all interfaces
-    address.sin_port = htons(port);
+// Accept one connection on port, or dial connect_host:port when it is set, and tune the
+// socket for sending. server_fd is the listening socket (or -1) for the caller to close.
+int open_stream(int port, const std::string& connect_host, int& server_fd)
+{
+    int new_socket;
+    struct sockaddr_in address;
+    int opt = 1;
+    int addrlen = sizeof(address);
+    server_fd = -1;
 
-    // Bind the socket
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    if (!connect_host.empty())
     {
-        std::cerr << "Bind failed\n";
-        close(server_fd);
-        return;
+        new_socket = connect_to_listener(connect_host, port);
+        if (new_socket < 0)
+        {
+            return -1;
+        }
     }
-
-    // Listen for incoming connections
-    if (listen(server_fd, 3) < 0)
+    else
     {
-        std::cerr << "Listen failed\n";
-        close(server_fd);
-        return;
-    }
+        // Create socket file descriptor
+        if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0)
+        {
+            std::cerr << "Socket failed\n";
+            return -1;
+        }
 
-    std::cout << "Mock server listening on port " << port << std::endl;
+        // Attach socket to the port
+        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)))
+        {
+            std::cerr << "setsockopt failed\n";
+            close(server_fd);
+            server_fd = -1;
+            return -1;
+        }
 
-    // Accept a single connection
-    if ((new_socket = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) < 0)
-    {
-        std::cerr << "Accept failed\n";
-        close(server_fd);
-        return;
-    }
+        // Initialize address struct
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY; // Listen on all interfaces
+        address.sin_port = htons(port);
+
+        // Bind the socket
+        if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+        {
+            std::cerr << "Bind failed\n";
+            close(server_fd);
+            server_fd = -1;
+            return -1;
+        }
+
+        // Listen for incoming connections
+        if (listen(server_fd, 3) < 0)
+        {
+            std::cerr << "Listen failed\n";
+            close(server_fd);
+            server_fd = -1;
+            return -1;
+        }
+
+        std::cout << "Mock server listening on port " << port << std::endl;
+
+        // Accept a single connection
+        if ((new_socket = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) < 0)
+        {
+            std::cerr << "Accept failed\n";
+            close(server_fd);
+            server_fd = -1;
+            return -1;
+        }
 
-    std::cout << "Mock server accepted a connection\n";
+        std::cout << "Mock server accepted a connection\n";
+    }
 
     // Set socket options for performance
     if (!set_socket_options(new_socket))
     {
         std::cerr << "Failed to set socket options\n";
         close(new_socket);
-        close(server_fd);
+        if (server_fd != -1)
+        {
+            close(server_fd);
+            server_fd = -1;
+        }
+        return -1;
+    }
+    return new_socket;
+}
+
+void mock_server(int port, int num_messages, int interval_us, const std::string& stop_message = "STOP",
+                 const std::string& connect_host = "")
+{
+    int server_fd = -1;
+    int new_socket = open_stream(port, connect_host, server_fd);
+    if (new_socket < 0)
+    {
         return;
     }
 
@@ -126,28 +202,521 @@ void mock_server(int port, int num_messages, int interval_us, const std::string&
 
     std::cout << "Mock server sent all messages and is closing connection\n";
     close(new_socket);
-    close(server_fd);
+    if (server_fd != -1)
+    {
+        close(server_fd);
+    }
+}
+
+// UDP socket aimed at host:port (unicast or a multicast group); -1 on failure
+int open_datagram_socket(const std::string& host, int port, struct sockaddr_in& address)
+{
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0)
+    {
+        std::cerr << "Socket failed\n";
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) <= 0)
+    {
+        std::cerr << "Invalid address " << host << "\n";
+        close(sockfd);
+        return -1;
+    }
+
+    if (IN_MULTICAST(ntohl(address.sin_addr.s_addr)))
+    {
+        // Stay on this host and loop the group back to local subscribers
+        unsigned char ttl = 1;
+        unsigned char loop = 1;
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+
+    int send_buffer_size = 8 * 1024 * 1024; // 8MB
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size));
+    return sockfd;
+}
+
+// Send the benchmark messages as UDP datagrams to host:port (unicast or a multicast
+// group), packing records_per_datagram newline-separated records into each one
+void udp_sender(const std::string& host, int port, int num_messages, int interval_us,
+                const std::string& stop_message, int records_per_datagram)
+{
+    struct sockaddr_in address;
+    int sockfd = open_datagram_socket(host, port, address);
+    if (sockfd < 0)
+    {
+        return;
+    }
+
+    std::cout << "Mock server sending datagrams to " << host << ":" << port << std::endl;
+
+    std::string base_message = "Benchmark Message ";
+    std::string datagram;
+    int sent_messages = 0;
+    while (sent_messages < num_messages)
+    {
+        datagram.clear();
+        for (int i = 0; i < records_per_datagram && sent_messages < num_messages; ++i, ++sent_messages)
+        {
+            if (!datagram.empty())
+            {
+                datagram += '\n';
+            }
+            datagram += base_message + std::to_string(sent_messages);
+        }
+        if (sendto(sockfd, datagram.data(), datagram.size(), 0, (struct sockaddr*)&address, sizeof(address)) < 0)
+        {
+            std::cerr << "Failed to send datagram: " << strerror(errno) << "\n";
+            break;
+        }
+        if (interval_us > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+        }
+    }
+
+    // Datagrams can be lost, so repeat the stop message a few times
+    for (int i = 0; i < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        sendto(sockfd, stop_message.data(), stop_message.size(), 0, (struct sockaddr*)&address, sizeof(address));
+    }
+    std::cout << "Mock server sent " << sent_messages << " messages and STOP\n";
+    close(sockfd);
+}
+
+// Capture Replay
+// Streams a capture file written by data_ingestion (capture.path) back out chunk by
+// chunk, straight from its read-only mapping. speed 1 keeps the original gaps between
+// chunks, 2 halves them, and 0 sends as fast as the socket accepts. Chunks that are due
+// together go out in one sendmsg (stream) or sendmmsg (datagrams) call. A stream
+// replay carries the bytes of exactly one captured connection, since splicing two
+// connections onto one socket would cut frames apart.
+
+const uint32_t ANY = UINT32_MAX; // Matches every feed or stream
+const size_t REPLAY_BATCH = 1024; // IOV_MAX, and the sendmmsg limit
+
+// Chunks picked by --feed and --stream
+struct ReplaySelection
+{
+    uint32_t feed = ANY;
+    uint32_t stream = ANY;
+
+    bool matches(const CaptureChunk& chunk) const
+    {
+        return (feed == ANY || chunk.feed_id == feed) && (stream == ANY || chunk.stream == stream);
+    }
+};
+
+// Totals of one captured connection
+struct StreamSummary
+{
+    uint32_t stream = 0;
+    uint32_t feed_id = 0;
+    uint64_t chunks = 0;
+    uint64_t bytes = 0;
+};
+
+// Selected connections in order of their first chunk, and the last selected chunk
+struct CaptureScan
+{
+    std::vector<StreamSummary> streams;
+    CaptureChunk last;
+};
+
+// Walk the chunk headers once, then rewind for the replay
+CaptureScan scan_capture(CaptureReader& reader, const ReplaySelection& selection)
+{
+    CaptureScan scan;
+    CaptureChunk chunk;
+    while (reader.next(chunk))
+    {
+        if (!selection.matches(chunk))
+        {
+            continue;
+        }
+        auto it = std::find_if(scan.streams.begin(), scan.streams.end(),
+                               [&chunk](const StreamSummary& summary) { return summary.stream == chunk.stream; });
+        if (it == scan.streams.end())
+        {
+            it = scan.streams.insert(scan.streams.end(), StreamSummary{chunk.stream, chunk.feed_id, 0, 0});
+        }
+        ++it->chunks;
+        it->bytes += chunk.length;
+        scan.last = chunk;
+    }
+    reader.rewind();
+    return scan;
+}
+
+// The stop message framed the way the captured connection framed its records
+std::string framed_stop(const std::string& stop_message, DecoderType framing, bool datagram)
+{
+    switch (framing)
+    {
+    case DecoderType::LengthPrefixed:
+    {
+        uint32_t length = htonl(static_cast<uint32_t>(stop_message.size()));
+        return std::string(reinterpret_cast<const char*>(&length), sizeof(length)) + stop_message;
+    }
+    case DecoderType::Line:
+        return datagram ? stop_message : stop_message + "\n";
+    default:
+        return stop_message;
+    }
+}
+
+// Whether the chunk finishes with the framed stop message, so the receiver already
+// gets it from the capture
+bool ends_with_stop(const CaptureChunk& chunk, const std::string& stop)
+{
+    if (chunk.length < stop.size() || memcmp(chunk.data + chunk.length - stop.size(), stop.data(), stop.size()) != 0)
+    {
+        return false;
+    }
+    // A line stop message must be a whole line, not the tail of a longer one
+    return chunk.framing != DecoderType::Line || chunk.length == stop.size() ||
+           chunk.data[chunk.length - stop.size() - 1] == '\n';
+}
+
+// Sleep through most of a gap and spin out the rest, since sleeps overshoot by tens of
+// microseconds
+void wait_until(std::chrono::steady_clock::time_point due)
+{
+    const auto spin = std::chrono::microseconds(100);
+    if (due - std::chrono::steady_clock::now() > spin)
+    {
+        std::this_thread::sleep_until(due - spin);
+    }
+    while (std::chrono::steady_clock::now() < due)
+    {
+    }
+}
+
+// Walk the selected chunks, handing each batch of due chunks to send_batch; false if a
+// send failed
+template <typename SendBatch>
+bool replay_chunks(CaptureReader& reader, double speed, const ReplaySelection& selection, SendBatch send_batch,
+                   uint64_t& chunks, uint64_t& bytes)
+{
+    auto next = [&reader, &selection](CaptureChunk& chunk)
+    {
+        while (reader.next(chunk))
+        {
+            if (selection.matches(chunk))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    CaptureChunk chunk;
+    bool have = next(chunk);
+    const uint64_t first_ns = chunk.timestamp_ns;
+    const auto start = std::chrono::steady_clock::now();
+    auto due = [first_ns, start, speed](const CaptureChunk& chunk)
+    {
+        // A wall clock stepped backwards during the capture makes chunks due at once
+        uint64_t offset_ns = chunk.timestamp_ns > first_ns ? chunk.timestamp_ns - first_ns : 0;
+        return start + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(offset_ns) / speed));
+    };
+
+    std::vector<CaptureChunk> batch;
+    batch.reserve(REPLAY_BATCH);
+    while (have)
+    {
+        if (speed > 0)
+        {
+            wait_until(due(chunk));
+        }
+        const auto now = std::chrono::steady_clock::now();
+        batch.clear();
+        do
+        {
+            batch.push_back(chunk);
+            bytes += chunk.length;
+            have = next(chunk);
+        } while (have && batch.size() < REPLAY_BATCH && (speed <= 0 || due(chunk) <= now));
+
+        if (!send_batch(batch))
+        {
+            return false;
+        }
+        chunks += batch.size();
+    }
+    return true;
+}
+
+// Write the chunks to a stream socket as one byte sequence, resuming after partial sends
+bool send_stream_batch(int sockfd, const std::vector<CaptureChunk>& batch, std::vector<struct iovec>& iov)
+{
+    iov.clear();
+    for (const CaptureChunk& chunk : batch)
+    {
+        iov.push_back({const_cast<char*>(chunk.data), chunk.length});
+    }
+    size_t first = 0;
+    while (first < iov.size())
+    {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov.data() + first;
+        message.msg_iovlen = iov.size() - first;
+        ssize_t sent = sendmsg(sockfd, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Failed to send replayed data: " << strerror(errno) << "\n";
+            return false;
+        }
+        size_t left = static_cast<size_t>(sent);
+        while (first < iov.size() && left >= iov[first].iov_len)
+        {
+            left -= iov[first].iov_len;
+            ++first;
+        }
+        if (left > 0)
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+// Send every chunk as one datagram
+bool send_datagram_batch(int sockfd, struct sockaddr_in& address, const std::vector<CaptureChunk>& batch,
+                         std::vector<struct iovec>& iov, std::vector<struct mmsghdr>& headers)
+{
+    iov.resize(batch.size());
+    headers.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        iov[i] = {const_cast<char*>(batch[i].data), batch[i].length};
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].msg_hdr.msg_name = &address;
+        headers[i].msg_hdr.msg_namelen = sizeof(address);
+        headers[i].msg_hdr.msg_iov = &iov[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t first = 0;
+    while (first < batch.size())
+    {
+        int sent = sendmmsg(sockfd, headers.data() + first, static_cast<unsigned int>(batch.size() - first), 0);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Failed to send replayed datagram: " << strerror(errno) << "\n";
+            return false;
+        }
+        first += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool replay(int port, const std::string& path, double speed, const ReplaySelection& selection,
+              const std::string& stop_message, const std::string& connect_host, bool udp)
+{
+    CaptureReader reader;
+    if (!reader.open(path))
+    {
+        return false;
+    }
+
+    CaptureScan scan = scan_capture(reader, selection);
+    if (scan.streams.empty())
+    {
+        std::cerr << "No chunks of " << path << " match the selected feed and stream\n";
+        return false;
+    }
+    // Datagrams stand alone, but stream bytes only decode in their own connection
+    if (!udp && scan.streams.size() > 1)
+    {
+        std::cerr << path << " holds " << scan.streams.size()
+                  << " connections; replay one of them over TCP with --stream=<id>:\n";
+        for (const StreamSummary& summary : scan.streams)
+        {
+            std::cerr << "  stream " << summary.stream << ": feed " << summary.feed_id << ", " << summary.chunks
+                      << " chunks, " << summary.bytes << " bytes\n";
+        }
+        return false;
+    }
+    const std::string stop = framed_stop(stop_message, scan.last.framing, udp);
+
+    uint64_t chunks = 0;
+    uint64_t bytes = 0;
+    std::vector<struct iovec> iov;
+    std::chrono::steady_clock::time_point started;
+    if (udp)
+    {
+        std::string host = connect_host.empty() ? "127.0.0.1" : connect_host;
+        struct sockaddr_in address;
+        int sockfd = open_datagram_socket(host, port, address);
+        if (sockfd < 0)
+        {
+            return false;
+        }
+        std::cout << "Mock server replaying " << path << " as datagrams to " << host << ":" << port << std::endl;
+        std::vector<struct mmsghdr> headers;
+        started = std::chrono::steady_clock::now();
+        bool sent_all = replay_chunks(reader, speed, selection,
+            [sockfd, &address, &iov, &headers](const std::vector<CaptureChunk>& batch)
+            {
+                return send_datagram_batch(sockfd, address, batch, iov, headers);
+            }, chunks, bytes);
+        if (!sent_all)
+        {
+            close(sockfd);
+            return false;
+        }
+
+        // Datagrams can be lost, so repeat the stop message a few times
+        for (int i = 0; i < 3; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            sendto(sockfd, stop.data(), stop.size(), 0, (struct sockaddr*)&address, sizeof(address));
+        }
+        close(sockfd);
+    }
+    else
+    {
+        int server_fd = -1;
+        int new_socket = open_stream(port, connect_host, server_fd);
+        if (new_socket < 0)
+        {
+            return false;
+        }
+        std::cout << "Mock server replaying " << path << std::endl;
+        started = std::chrono::steady_clock::now();
+        bool sent_all = replay_chunks(reader, speed, selection,
+            [new_socket, &iov](const std::vector<CaptureChunk>& batch)
+            {
+                return send_stream_batch(new_socket, batch, iov);
+            }, chunks, bytes);
+
+        // A capture that ended with STOP already carries it
+        if (sent_all && !ends_with_stop(scan.last, stop) &&
+            send(new_socket, stop.data(), stop.size(), MSG_NOSIGNAL) != (ssize_t)stop.size())
+        {
+            std::cerr << "Failed to send STOP message\n";
+        }
+        close(new_socket);
+        if (server_fd != -1)
+        {
+            close(server_fd);
+        }
+        if (!sent_all)
+        {
+            return false;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Mock server replayed " << chunks << " chunks (" << bytes << " bytes) in " << seconds << " s";
+    if (seconds > 0)
+    {
+        std::cout << ", " << bytes / seconds / (1024 * 1024) << " MB/s";
+    }
+    std::cout << " and sent STOP\n";
+    return true;
 }
 
 int main(int argc, char* argv[])
 {
-    if (argc < 4)
+    // --connect=<host> makes the mock server dial out instead of listening;
+    // --udp[=records_per_datagram] sends datagrams to <host> (127.0.0.1 by default);
+    // --replay=<capture file> sends captured traffic instead of benchmark messages, at
+    // --speed=<factor> (1 by default, 0 as fast as possible), only --feed=<id> and
+    // --stream=<id> if given
+    std::vector<std::string> args;
+    std::string connect_host;
+    int records_per_datagram = 0;
+    std::string replay_path;
+    double speed = 1.0;
+    ReplaySelection selection;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--connect=", 0) == 0)
+        {
+            connect_host = arg.substr(10);
+        }
+        else if (arg.rfind("--replay=", 0) == 0)
+        {
+            replay_path = arg.substr(9);
+        }
+        else if (arg.rfind("--speed=", 0) == 0)
+        {
+            speed = std::max(0.0, std::stod(arg.substr(8)));
+        }
+        else if (arg.rfind("--feed=", 0) == 0)
+        {
+            selection.feed = static_cast<uint32_t>(std::stoul(arg.substr(7)));
+        }
+        else if (arg.rfind("--stream=", 0) == 0)
+        {
+            selection.stream = static_cast<uint32_t>(std::stoul(arg.substr(9)));
+        }
+        else if (arg == "--udp")
+        {
+            records_per_datagram = 1;
+        }
+        else if (arg.rfind("--udp=", 0) == 0)
+        {
+            records_per_datagram = std::max(1, std::stoi(arg.substr(6)));
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (!replay_path.empty() && !args.empty())
     {
-        std::cerr << "Usage: mock_server <port> <num_messages> <interval_us> [stop_message]\n";
+        bool replayed = replay(std::stoi(args[0]), replay_path, speed, selection,
+                               args.size() >= 2 ? args[1] : "STOP", connect_host, records_per_datagram > 0);
+        return replayed ? 0 : -1;
+    }
+
+    if (args.size() < 3)
+    {
+        std::cerr << "Usage: mock_server <port> <num_messages> <interval_us> [stop_message] [--connect=<host>] [--udp[=records_per_datagram]]\n"
+                  << "       mock_server <port> [stop_message] --replay=<capture file> [--speed=<factor>] [--feed=<id>] [--stream=<id>] [--connect=<host>] [--udp]\n";
         return -1;
     }
 
-    int port = std::stoi(argv[1]);
-    int num_messages = std::stoi(argv[2]);
-    int interval_us = std::stoi(argv[3]);
+    int port = std::stoi(args[0]);
+    int num_messages = std::stoi(args[1]);
+    int interval_us = std::stoi(args[2]);
     std::string stop_message = "STOP";
 
-    if (argc >= 5)
+    if (args.size() >= 4)
     {
-        stop_message = argv[4];
+        stop_message = args[3];
     }
 
-    mock_server(port, num_messages, interval_us, stop_message);
+    if (records_per_datagram > 0)
+    {
+        udp_sender(connect_host.empty() ? "127.0.0.1" : connect_host, port, num_messages, interval_us,
+                   stop_message, records_per_datagram);
+    }
+    else
+    {
+        mock_server(port, num_messages, interval_us, stop_message, connect_host);
+    }
 
     return 0;
 }
@@ -0,0 +1,78 @@
+// shm_consumer/shm_consumer.cpp
+
+#include "ingestion/shm_ring.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Attach to the shared-memory output of data_ingestion (shm.name) and count records
+// until the writer finishes. Any number of these can run side by side.
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: shm_consumer <shm_name> [print_every]\n";
+        return -1;
+    }
+    std::string name = argv[1];
+    uint64_t print_every = argc >= 3 ? std::stoull(argv[2]) : 0;
+
+    // The writer may not have created the segment yet
+    ShmRingReader reader;
+    bool attached = false;
+    for (int attempt = 0; attempt < 100 && !attached; ++attempt)
+    {
+        attached = reader.open(name);
+        if (!attached)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!attached)
+    {
+        return -1;
+    }
+    std::cout << "Attached to " << name << std::endl;
+
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    std::vector<uint64_t> per_feed;
+    auto start = std::chrono::steady_clock::now();
+    while (!reader.finished())
+    {
+        size_t polled = reader.poll([&](uint32_t feed_id, uint64_t, std::string_view message)
+        {
+            if (feed_id >= per_feed.size())
+            {
+                per_feed.resize(feed_id + 1, 0);
+            }
+            ++per_feed[feed_id];
+            ++records;
+            bytes += message.size();
+            if (print_every > 0 && records % print_every == 0)
+            {
+                std::cout << "Feed " << feed_id << ": " << message << "\n";
+            }
+        });
+        if (polled == 0)
+        {
+            reader.wait(100);
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Records: " << records << ", bytes: " << bytes << ", writer drops: " << reader.dropped() << "\n";
+    for (size_t feed = 0; feed < per_feed.size(); ++feed)
+    {
+        std::cout << "Feed " << feed << ": " << per_feed[feed] << " records\n";
+    }
+    if (elapsed > 0)
+    {
+        std::cout << "Throughput: " << static_cast<uint64_t>(records / elapsed) << " records/sec\n";
+    }
+    return 0;
+}
@@ -0,0 +1,615 @@
+// src/aggregation.cpp
+
+#include "ingestion/aggregation.hpp"
+#include "ingestion/sharding.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const double GAMMA = (1.0 + QuantileSketch::RELATIVE_ACCURACY) / (1.0 - QuantileSketch::RELATIVE_ACCURACY);
+    const double LOG_GAMMA = std::log(GAMMA);
+
+    // Magnitudes below this are counted as zero
+    const double MIN_MAGNITUDE = 1e-9;
+
+    // Representative value of a bucket: within RELATIVE_ACCURACY of everything in it
+    double bucket_value(int32_t index)
+    {
+        return 2.0 * std::pow(GAMMA, index) / (GAMMA + 1.0);
+    }
+
+    // MurmurHash3 finalizer; spreads FNV-1a output over all 64 bits for HyperLogLog
+    uint64_t mix64(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Split frame into its first max_field + 1 fields; returns the number found
+    size_t split_fields(std::string_view frame, char delimiter, size_t max_field, std::string_view* fields)
+    {
+        size_t count = 0;
+        size_t start = 0;
+        while (count <= max_field)
+        {
+            size_t end = frame.find(delimiter, start);
+            if (end == std::string_view::npos)
+            {
+                fields[count++] = frame.substr(start);
+                break;
+            }
+            fields[count++] = frame.substr(start, end - start);
+            start = end + 1;
+        }
+        return count;
+    }
+
+    bool parse_value(std::string_view text, double& out)
+    {
+        const char* begin = text.data();
+        const char* end = text.data() + text.size();
+        while (begin < end && *begin == ' ')
+        {
+            ++begin;
+        }
+        auto result = std::from_chars(begin, end, out);
+        return result.ec == std::errc() && std::isfinite(out);
+    }
+
+    // Fields a frame is split into before aggregation
+    const size_t MAX_AGGREGATION_FIELD = 63;
+}
+
+void QuantileSketch::Store::add(int32_t index, uint64_t count)
+{
+    if (counts.empty())
+    {
+        offset = index;
+        counts.assign(1, 0);
+    }
+    int64_t low = std::min<int64_t>(index, offset);
+    int64_t high = std::max<int64_t>(index, offset + static_cast<int64_t>(counts.size()) - 1);
+    if (high - low + 1 > static_cast<int64_t>(MAX_BUCKETS))
+    {
+        // Fold the smallest magnitudes into the lowest bucket that still fits
+        low = high - static_cast<int64_t>(MAX_BUCKETS) + 1;
+        index = static_cast<int32_t>(std::max<int64_t>(index, low));
+    }
+    if (low != offset || high != offset + static_cast<int64_t>(counts.size()) - 1)
+    {
+        std::vector<uint64_t> resized(static_cast<size_t>(high - low + 1), 0);
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            int64_t bucket = std::max<int64_t>(offset + static_cast<int64_t>(i), low);
+            resized[static_cast<size_t>(bucket - low)] += counts[i];
+        }
+        counts.swap(resized);
+        offset = static_cast<int32_t>(low);
+    }
+    counts[static_cast<size_t>(index - offset)] += count;
+}
+
+void QuantileSketch::Store::reset()
+{
+    counts.clear();
+    offset = 0;
+}
+
+void QuantileSketch::add(double value)
+{
+    ++count_;
+    double magnitude = std::fabs(value);
+    if (magnitude < MIN_MAGNITUDE)
+    {
+        ++zero_count_;
+        return;
+    }
+    int32_t index = static_cast<int32_t>(std::ceil(std::log(magnitude) / LOG_GAMMA));
+    (value > 0 ? positive_ : negative_).add(index, 1);
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    for (size_t i = 0; i < other.positive_.counts.size(); ++i)
+    {
+        if (other.positive_.counts[i] != 0)
+        {
+            positive_.add(other.positive_.offset + static_cast<int32_t>(i), other.positive_.counts[i]);
+        }
+    }
+    for (size_t i = 0; i < other.negative_.counts.size(); ++i)
+    {
+        if (other.negative_.counts[i] != 0)
+        {
+            negative_.add(other.negative_.offset + static_cast<int32_t>(i), other.negative_.counts[i]);
+        }
+    }
+    zero_count_ += other.zero_count_;
+    count_ += other.count_;
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    if (count_ == 0)
+    {
+        return 0.0;
+    }
+    q = std::min(1.0, std::max(0.0, q));
+    const double rank = q * static_cast<double>(count_ - 1);
+    double seen = 0.0;
+
+    // Most negative first, then zero, then ascending positives
+    for (size_t i = negative_.counts.size(); i-- > 0;)
+    {
+        seen += static_cast<double>(negative_.counts[i]);
+        if (seen > rank)
+        {
+            return -bucket_value(negative_.offset + static_cast<int32_t>(i));
+        }
+    }
+    seen += static_cast<double>(zero_count_);
+    if (seen > rank)
+    {
+        return 0.0;
+    }
+    for (size_t i = 0; i < positive_.counts.size(); ++i)
+    {
+        seen += static_cast<double>(positive_.counts[i]);
+        if (seen > rank)
+        {
+            return bucket_value(positive_.offset + static_cast<int32_t>(i));
+        }
+    }
+    return positive_.counts.empty() ? 0.0
+                                    : bucket_value(positive_.offset + static_cast<int32_t>(positive_.counts.size()) - 1);
+}
+
+void QuantileSketch::reset()
+{
+    positive_.reset();
+    negative_.reset();
+    zero_count_ = 0;
+    count_ = 0;
+}
+
+void HyperLogLog::add(uint64_t hash)
+{
+    if (registers_.empty())
+    {
+        registers_.assign(size_t(1) << PRECISION, 0);
+    }
+    size_t index = static_cast<size_t>(hash >> (64 - PRECISION));
+    // The sentinel bit caps the rank at 64 - PRECISION + 1
+    uint64_t rest = (hash << PRECISION) | (uint64_t(1) << (PRECISION - 1));
+    uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers_[index])
+    {
+        registers_[index] = rank;
+    }
+}
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+    if (other.registers_.empty())
+    {
+        return;
+    }
+    if (registers_.empty())
+    {
+        registers_ = other.registers_;
+        return;
+    }
+    for (size_t i = 0; i < registers_.size(); ++i)
+    {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const
+{
+    if (registers_.empty())
+    {
+        return 0;
+    }
+    const double m = static_cast<double>(registers_.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t rank : registers_)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(rank));
+        zeros += rank == 0;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0)
+    {
+        // Small-range correction: linear counting over the empty registers
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return static_cast<uint64_t>(estimate + 0.5);
+}
+
+void HyperLogLog::reset()
+{
+    std::fill(registers_.begin(), registers_.end(), 0);
+}
+
+void KeyAggregate::reset()
+{
+    count = 0;
+    valued = 0;
+    sum = 0.0;
+    min = std::numeric_limits<double>::infinity();
+    max = -std::numeric_limits<double>::infinity();
+    values.reset();
+    distinct.reset();
+}
+
+void KeyAggregate::merge(const KeyAggregate& other)
+{
+    count += other.count;
+    valued += other.valued;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    values.merge(other.values);
+    distinct.merge(other.distinct);
+}
+
+uint64_t aggregation_key_hash(uint32_t feed_id, std::string_view key)
+{
+    uint64_t hash = mix64(hash_shard_key(key) ^ (static_cast<uint64_t>(feed_id) * 0x9e3779b97f4a7c15ULL));
+    return hash == 0 ? 1 : hash;
+}
+
+KeyTable::KeyTable()
+    : slots_(16, Slot{0, 0}), mask_(15)
+{
+}
+
+KeyAggregate& KeyTable::find_or_insert(uint32_t feed_id, std::string_view key, uint64_t hash)
+{
+    if ((size_ + 1) * 2 > slots_.size())
+    {
+        grow();
+    }
+    size_t index = static_cast<size_t>(hash) & mask_;
+    while (slots_[index].hash != 0)
+    {
+        if (slots_[index].hash == hash)
+        {
+            const Entry& entry = entries_[slots_[index].entry];
+            if (entry.feed_id == feed_id && entry.key_length == key.size() &&
+                memcmp(keys_.data() + entry.key_offset, key.data(), key.size()) == 0)
+            {
+                return aggregates_[slots_[index].entry];
+            }
+        }
+        index = (index + 1) & mask_;
+    }
+
+    slots_[index] = Slot{hash, static_cast<uint32_t>(size_)};
+    Entry entry{hash, feed_id, static_cast<uint32_t>(key.size()), keys_.size()};
+    keys_.append(key.data(), key.size());
+    if (size_ < entries_.size())
+    {
+        entries_[size_] = entry;
+        aggregates_[size_].reset();
+    }
+    else
+    {
+        entries_.push_back(entry);
+        aggregates_.emplace_back();
+    }
+    return aggregates_[size_++];
+}
+
+void KeyTable::merge(const KeyTable& other)
+{
+    for (size_t i = 0; i < other.size_; ++i)
+    {
+        const Entry& entry = other.entries_[i];
+        std::string_view key(other.keys_.data() + entry.key_offset, entry.key_length);
+        find_or_insert(entry.feed_id, key, entry.hash).merge(other.aggregates_[i]);
+    }
+}
+
+void KeyTable::grow()
+{
+    size_t capacity = slots_.size() * 2;
+    slots_.assign(capacity, Slot{0, 0});
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < size_; ++i)
+    {
+        size_t index = static_cast<size_t>(entries_[i].hash) & mask_;
+        while (slots_[index].hash != 0)
+        {
+            index = (index + 1) & mask_;
+        }
+        slots_[index] = Slot{entries_[i].hash, static_cast<uint32_t>(i)};
+    }
+}
+
+void KeyTable::clear()
+{
+    if (size_ == 0)
+    {
+        return;
+    }
+    std::fill(slots_.begin(), slots_.end(), Slot{0, 0});
+    size_ = 0;
+    keys_.clear();
+}
+
+WindowAggregator::WindowAggregator(const AggregationConfig& config, size_t partials, WindowCallback on_window)
+    : config_(config), on_window_(std::move(on_window))
+{
+    uint64_t window = std::max<uint64_t>(config.window_ms, 1);
+    slide_ms_ = (config.slide_ms == 0 || config.slide_ms > window) ? window : config.slide_ms;
+    panes_per_window_ = (window + slide_ms_ - 1) / slide_ms_;
+    if (window % slide_ms_ != 0)
+    {
+        std::cerr << "aggregate.window_ms rounded up to " << panes_per_window_ * slide_ms_ << " ms, a multiple of slide_ms\n";
+    }
+
+    max_field_ = config.key_field;
+    if (config.value_field >= 0)
+    {
+        max_field_ = std::max(max_field_, static_cast<size_t>(config.value_field));
+    }
+    if (config.distinct_field >= 0)
+    {
+        max_field_ = std::max(max_field_, static_cast<size_t>(config.distinct_field));
+    }
+    if (max_field_ > MAX_AGGREGATION_FIELD)
+    {
+        std::cerr << "Aggregation fields beyond " << MAX_AGGREGATION_FIELD << " are ignored\n";
+        max_field_ = MAX_AGGREGATION_FIELD;
+    }
+
+    for (size_t i = 0; i < std::max<size_t>(partials, 1); ++i)
+    {
+        partials_.emplace_back(new Partial());
+    }
+}
+
+void WindowAggregator::add(size_t partial, const std::vector<std::shared_ptr<DataRecord>>& batch)
+{
+    Partial& state = *partials_[partial % partials_.size()];
+    std::string_view fields[MAX_AGGREGATION_FIELD + 1];
+    uint64_t added = 0;
+    uint64_t late = 0;
+    uint64_t unparsed = 0;
+    uint64_t newest = 0;
+    uint64_t earliest = UINT64_MAX;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        // Read under the lock: a closer advances it before taking partial locks
+        const uint64_t end_pane = next_end_pane_.load(std::memory_order_acquire);
+        KeyTable* table = nullptr;
+        uint64_t table_pane = UINT64_MAX;
+        for (const auto& record : batch)
+        {
+            const uint64_t pane = record->timestamp / slide_ms_;
+            if (end_pane != 0 && pane + panes_per_window_ < end_pane)
+            {
+                ++late; // Every window covering this pane has already closed
+                continue;
+            }
+            if (pane != table_pane)
+            {
+                std::unique_ptr<KeyTable>& slot = state.panes[pane];
+                if (!slot)
+                {
+                    if (!state.spare.empty())
+                    {
+                        slot = std::move(state.spare.back());
+                        state.spare.pop_back();
+                    }
+                    else
+                    {
+                        slot.reset(new KeyTable());
+                    }
+                }
+                table = slot.get();
+                table_pane = pane;
+            }
+
+            size_t found = split_fields(record->message, config_.delimiter, max_field_, fields);
+            std::string_view key = config_.key_field < found ? fields[config_.key_field] : std::string_view();
+            KeyAggregate& aggregate = table->find_or_insert(record->feed_id, key, aggregation_key_hash(record->feed_id, key));
+            ++aggregate.count;
+            if (config_.value_field >= 0)
+            {
+                double value;
+                if (static_cast<size_t>(config_.value_field) < found &&
+                    parse_value(fields[config_.value_field], value))
+                {
+                    ++aggregate.valued;
+                    aggregate.sum += value;
+                    aggregate.min = std::min(aggregate.min, value);
+                    aggregate.max = std::max(aggregate.max, value);
+                    aggregate.values.add(value);
+                }
+                else
+                {
+                    ++unparsed;
+                }
+            }
+            if (config_.distinct_field >= 0 && static_cast<size_t>(config_.distinct_field) < found)
+            {
+                aggregate.distinct.add(mix64(hash_shard_key(fields[config_.distinct_field])));
+            }
+            ++added;
+            newest = std::max(newest, record->timestamp);
+            earliest = std::min(earliest, record->timestamp);
+        }
+    }
+    state.records.fetch_add(added, std::memory_order_relaxed);
+    if (late > 0)
+    {
+        state.late.fetch_add(late, std::memory_order_relaxed);
+    }
+    if (unparsed > 0)
+    {
+        state.unparsed.fetch_add(unparsed, std::memory_order_relaxed);
+    }
+    if (added == 0)
+    {
+        return;
+    }
+
+    // The first data fixes the first window: the one ending just after the pane lateness_ms
+    // before it, so records another consumer delivers a moment later for an earlier pane
+    // still land in a window that has not closed
+    const uint64_t first_pane = (earliest - std::min<uint64_t>(earliest, config_.lateness_ms)) / slide_ms_;
+    uint64_t unset = 0;
+    next_end_pane_.compare_exchange_strong(unset, first_pane + 1, std::memory_order_acq_rel);
+
+    if (newest > state.newest.load(std::memory_order_relaxed))
+    {
+        state.newest.store(newest, std::memory_order_relaxed);
+    }
+    uint64_t watermark = UINT64_MAX;
+    for (const auto& partial : partials_)
+    {
+        uint64_t partial_newest = partial->newest.load(std::memory_order_relaxed);
+        if (partial_newest != 0)
+        {
+            watermark = std::min(watermark, partial_newest);
+        }
+    }
+    advance(watermark);
+}
+
+void WindowAggregator::advance(uint64_t watermark_ms)
+{
+    if (watermark_ms < config_.lateness_ms)
+    {
+        return;
+    }
+    // Windows ending at or before the watermark are complete
+    const uint64_t limit = (watermark_ms - config_.lateness_ms) / slide_ms_;
+    const uint64_t next = next_end_pane_.load(std::memory_order_acquire);
+    if (next == 0 || next > limit)
+    {
+        return;
+    }
+    close_through(limit, false);
+}
+
+void WindowAggregator::flush()
+{
+    uint64_t last_pane = 0;
+    bool any = false;
+    for (auto& partial : partials_)
+    {
+        std::lock_guard<std::mutex> lock(partial->mutex);
+        if (!partial->panes.empty())
+        {
+            last_pane = std::max(last_pane, partial->panes.rbegin()->first);
+            any = true;
+        }
+    }
+    if (any)
+    {
+        // The last window covering last_pane ends panes_per_window_ later
+        close_through(last_pane + panes_per_window_, true);
+    }
+}
+
+void WindowAggregator::close_through(uint64_t limit, bool wait)
+{
+    std::unique_lock<std::mutex> close_lock(close_mutex_, std::defer_lock);
+    if (wait)
+    {
+        close_lock.lock();
+    }
+    else if (!close_lock.try_lock())
+    {
+        return; // Another consumer is closing; it or the next batch will catch up
+    }
+
+    uint64_t end = next_end_pane_.load(std::memory_order_acquire);
+    while (end != 0 && end <= limit)
+    {
+        const uint64_t first = end > panes_per_window_ ? end - panes_per_window_ : 0;
+        const uint64_t keep_from = end + 1 > panes_per_window_ ? end + 1 - panes_per_window_ : 0;
+        // Published before the partial locks so no adder can slip a record into a pane
+        // after it has been merged
+        next_end_pane_.store(end + 1, std::memory_order_release);
+
+        merged_.clear();
+        uint64_t next_data = UINT64_MAX;
+        for (auto& partial : partials_)
+        {
+            std::lock_guard<std::mutex> lock(partial->mutex);
+            auto& panes = partial->panes;
+            for (auto it = panes.lower_bound(first); it != panes.end() && it->first < end; ++it)
+            {
+                merged_.merge(*it->second);
+            }
+            // Panes before keep_from belong to no later window
+            while (!panes.empty() && panes.begin()->first < keep_from)
+            {
+                panes.begin()->second->clear();
+                partial->spare.push_back(std::move(panes.begin()->second));
+                panes.erase(panes.begin());
+            }
+            if (!panes.empty())
+            {
+                next_data = std::min(next_data, panes.begin()->first);
+            }
+        }
+
+        if (!merged_.empty())
+        {
+            WindowResult result;
+            result.start_ms = first * slide_ms_;
+            result.end_ms = end * slide_ms_;
+            result.keys.reserve(merged_.size());
+            merged_.for_each([&result](uint32_t feed_id, std::string_view key, const KeyAggregate& aggregate)
+            {
+                result.records += aggregate.count;
+                result.keys.push_back(WindowKeyResult{feed_id, std::string(key), aggregate});
+            });
+            windows_.fetch_add(1, std::memory_order_relaxed);
+            if (on_window_)
+            {
+                on_window_(result);
+            }
+        }
+
+        // Skip the empty windows up to the first one holding a remaining pane
+        if (next_data == UINT64_MAX)
+        {
+            end = std::max(end + 1, limit + 1);
+        }
+        else
+        {
+            end = std::max(end + 1, next_data + 1);
+        }
+        next_end_pane_.store(end, std::memory_order_release);
+    }
+}
+
+AggregationStats WindowAggregator::stats() const
+{
+    AggregationStats stats;
+    for (const auto& partial : partials_)
+    {
+        stats.records += partial->records.load(std::memory_order_relaxed);
+        stats.late += partial->late.load(std::memory_order_relaxed);
+        stats.unparsed += partial->unparsed.load(std::memory_order_relaxed);
+    }
+    stats.windows = windows_.load(std::memory_order_relaxed);
+    return stats;
+}
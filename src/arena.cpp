@@ -0,0 +1,192 @@
+// src/arena.cpp
+
+#include "ingestion/arena.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace
+{
+    const size_t HUGE_PAGE_2M = size_t(2) << 20;
+    const size_t HUGE_PAGE_1G = size_t(1) << 30;
+
+    size_t round_up(size_t value, size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+const char* arena_backing_name(ArenaBacking backing)
+{
+    switch (backing)
+    {
+    case ArenaBacking::HugePages1G:
+        return "1 GB huge pages";
+    case ArenaBacking::HugePages2M:
+        return "2 MB huge pages";
+    case ArenaBacking::Transparent:
+        return "transparent huge pages";
+    case ArenaBacking::SmallPages:
+        return "4 KB pages";
+    default:
+        return "heap";
+    }
+}
+
+Arena::Arena(const MemoryConfig& config)
+{
+    if (config.arena_bytes == 0)
+    {
+        return;
+    }
+    auto started = std::chrono::steady_clock::now();
+
+    const int base_flags = MAP_PRIVATE | MAP_ANONYMOUS | (config.prefault ? MAP_POPULATE : 0);
+    bool mapped = false;
+    if (config.huge_pages)
+    {
+        // hugetlbfs pages come from the boot-time or sysctl reserve; without enough free
+        // ones mmap fails and the next size is tried
+        if (config.arena_bytes >= HUGE_PAGE_1G)
+        {
+            mapped = map(round_up(config.arena_bytes, HUGE_PAGE_1G), base_flags | MAP_HUGETLB | MAP_HUGE_1GB,
+                         ArenaBacking::HugePages1G);
+        }
+        if (!mapped)
+        {
+            mapped = map(round_up(config.arena_bytes, HUGE_PAGE_2M), base_flags | MAP_HUGETLB | MAP_HUGE_2MB,
+                         ArenaBacking::HugePages2M);
+        }
+    }
+    if (!mapped)
+    {
+        // Over-map by one huge page so the region can start on a 2 MB boundary, which
+        // transparent huge pages need; MAP_POPULATE would fault 4 KB pages in before the
+        // madvise, so prefaulting is done by hand below
+        size_t size = round_up(config.arena_bytes, HUGE_PAGE_2M);
+        void* region = mmap(nullptr, size + HUGE_PAGE_2M, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+        {
+            std::cerr << "Arena: mapping " << size << " bytes failed: " << strerror(errno) << "; using the heap\n";
+            return;
+        }
+        char* start = static_cast<char*>(region);
+        char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(start), HUGE_PAGE_2M));
+        if (aligned > start)
+        {
+            munmap(start, static_cast<size_t>(aligned - start));
+        }
+        size_t tail = HUGE_PAGE_2M - static_cast<size_t>(aligned - start);
+        if (tail > 0)
+        {
+            munmap(aligned + size, tail);
+        }
+        base_ = aligned;
+        size_ = size;
+        backing_ = ArenaBacking::SmallPages;
+        if (config.huge_pages && madvise(base_, size_, MADV_HUGEPAGE) == 0)
+        {
+            backing_ = ArenaBacking::Transparent;
+        }
+        if (config.prefault)
+        {
+            const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            for (size_t offset = 0; offset < size_; offset += page)
+            {
+                base_[offset] = 0;
+            }
+        }
+    }
+
+    if (config.lock)
+    {
+        if (mlock(base_, size_) == 0)
+        {
+            locked_ = true;
+        }
+        else
+        {
+            std::cerr << "Arena: mlock failed: " << strerror(errno) << " (check RLIMIT_MEMLOCK)\n";
+        }
+    }
+    reserve_ns_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count());
+}
+
+Arena::~Arena()
+{
+    if (base_ != nullptr)
+    {
+        munmap(base_, size_);
+    }
+}
+
+bool Arena::map(size_t size, int flags, ArenaBacking backing)
+{
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return false;
+    }
+    base_ = static_cast<char*>(region);
+    size_ = size;
+    backing_ = backing;
+    return true;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    if (base_ != nullptr)
+    {
+        size_t used = used_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            size_t offset = round_up(used, alignment);
+            if (offset + size > size_)
+            {
+                break;
+            }
+            if (used_.compare_exchange_weak(used, offset + size, std::memory_order_relaxed))
+            {
+                return base_ + offset;
+            }
+        }
+    }
+    heap_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size, std::align_val_t(alignment));
+}
+
+void Arena::deallocate(void* block, size_t, size_t alignment)
+{
+    if (!contains(block))
+    {
+        ::operator delete(block, std::align_val_t(alignment));
+    }
+}
+
+ArenaStats Arena::stats() const
+{
+    ArenaStats stats;
+    stats.backing = backing_;
+    stats.reserved = size_;
+    stats.used = std::min(used_.load(std::memory_order_relaxed), size_);
+    stats.heap_fallbacks = heap_fallbacks_.load(std::memory_order_relaxed);
+    stats.reserve_ns = reserve_ns_;
+    stats.locked = locked_;
+    return stats;
+}
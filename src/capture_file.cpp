@@ -0,0 +1,207 @@
+// src/capture_file.cpp
+
+#include "ingestion/capture_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const char CAPTURE_MAGIC[8] = {'I', 'N', 'G', 'C', 'A', 'P', 'T', '\0'};
+    const uint32_t CAPTURE_VERSION = 2;
+
+    // Write the whole range, retrying on short writes and EINTR
+    bool write_all(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = write(fd, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1)
+    {
+        std::cerr << "Failed to open capture file " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    path_ = path;
+    chunks_ = 0;
+    bytes_ = 0;
+    streams_ = 0;
+    write_buffer_.clear();
+    write_buffer_.reserve(WRITE_BUFFER_SIZE);
+
+    CaptureFileHeader header;
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.reserved = 0;
+    const char* header_bytes = reinterpret_cast<const char*>(&header);
+    write_buffer_.insert(write_buffer_.end(), header_bytes, header_bytes + sizeof(header));
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (fd_ != -1)
+    {
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool CaptureWriter::append(uint64_t timestamp_ns, uint32_t feed_id, uint32_t stream, DecoderType framing,
+                           const char* data, size_t size)
+{
+    if (fd_ == -1)
+    {
+        return false;
+    }
+    CaptureChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.timestamp_ns = timestamp_ns;
+    header.feed_id = feed_id;
+    header.stream = stream;
+    header.length = static_cast<uint32_t>(size);
+    header.framing = static_cast<uint8_t>(framing);
+    if (write_buffer_.size() + sizeof(header) + size > WRITE_BUFFER_SIZE && !flush())
+    {
+        return false;
+    }
+    const char* header_bytes = reinterpret_cast<const char*>(&header);
+    write_buffer_.insert(write_buffer_.end(), header_bytes, header_bytes + sizeof(header));
+    write_buffer_.insert(write_buffer_.end(), data, data + size);
+    ++chunks_;
+    bytes_ += size;
+    return true;
+}
+
+bool CaptureWriter::flush()
+{
+    if (write_buffer_.empty())
+    {
+        return true;
+    }
+    if (!write_all(fd_, write_buffer_.data(), write_buffer_.size()))
+    {
+        std::cerr << "Failed to write capture file " << path_ << ": " << strerror(errno) << "; capture stopped\n";
+        ::close(fd_);
+        fd_ = -1;
+        write_buffer_.clear();
+        return false;
+    }
+    write_buffer_.clear();
+    return true;
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        std::cerr << "Failed to open capture file " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CaptureFileHeader))
+    {
+        std::cerr << "Capture file " << path << " is too short\n";
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map capture file " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    CaptureFileHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != CAPTURE_VERSION)
+    {
+        std::cerr << path << " is not a capture file\n";
+        munmap(mapping, size);
+        return false;
+    }
+    base_ = static_cast<const char*>(mapping);
+    size_ = size;
+    position_ = sizeof(header);
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (base_ != nullptr)
+    {
+        munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+        position_ = 0;
+    }
+}
+
+bool CaptureReader::next(CaptureChunk& chunk)
+{
+    CaptureChunkHeader header;
+    if (base_ == nullptr || size_ - position_ < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, base_ + position_, sizeof(header));
+    if (size_ - position_ - sizeof(header) < header.length)
+    {
+        return false;
+    }
+    chunk.timestamp_ns = header.timestamp_ns;
+    chunk.feed_id = header.feed_id;
+    chunk.stream = header.stream;
+    chunk.length = header.length;
+    chunk.framing = static_cast<DecoderType>(header.framing);
+    chunk.data = base_ + position_ + sizeof(header);
+    position_ += sizeof(header) + header.length;
+    return true;
+}
+
+void CaptureReader::rewind()
+{
+    if (base_ != nullptr)
+    {
+        position_ = sizeof(CaptureFileHeader);
+    }
+}
@@ -2,13 +2,637 @@
 
 #include "ingestion/config.hpp"
 
-// Implement configuration loading if needed
-// For simplicity, we'll return hardcoded default values
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 
 IngestionConfig get_default_config()
 {
     IngestionConfig config;
-    config.ip = "127.0.0.1"; // Localhost for testing
-    config.port = 5555;       // Example port
+    config.endpoints.push_back({"127.0.0.1", 5555, DecoderType::Line, Transport::Tcp, {}}); // Localhost test endpoint
     return config;
 }
+
+namespace
+{
+    std::string trim(const std::string& text)
+    {
+        size_t start = text.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(start, end - start + 1);
+    }
+
+    bool parse_size(const std::string& text, size_t& out)
+    {
+        if (text.empty() || text[0] == '-')
+        {
+            return false;
+        }
+        errno = 0;
+        char* end = nullptr;
+        unsigned long long value = strtoull(text.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0')
+        {
+            return false;
+        }
+        out = static_cast<size_t>(value);
+        return true;
+    }
+
+    bool parse_int(const std::string& text, int& out)
+    {
+        if (text.empty())
+        {
+            return false;
+        }
+        errno = 0;
+        char* end = nullptr;
+        long value = strtol(text.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || value < -2147483647L || value > 2147483647L)
+        {
+            return false;
+        }
+        out = static_cast<int>(value);
+        return true;
+    }
+
+    // Range-checked variants; out is only written once the value is accepted, so a
+    // rejected setting leaves the config untouched
+    bool parse_size_in(const std::string& text, size_t& out, size_t min, size_t max = SIZE_MAX)
+    {
+        size_t value = 0;
+        if (!parse_size(text, value) || value < min || value > max)
+        {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    bool parse_int_in(const std::string& text, int& out, int min, int max = INT_MAX)
+    {
+        int value = 0;
+        if (!parse_int(text, value) || value < min || value > max)
+        {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    bool parse_bool(const std::string& text, bool& out)
+    {
+        if (text == "true")
+        {
+            out = true;
+            return true;
+        }
+        if (text == "false")
+        {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_decoder(const std::string& text, DecoderType& out)
+    {
+        if (text == "line")
+        {
+            out = DecoderType::Line;
+            return true;
+        }
+        if (text == "length")
+        {
+            out = DecoderType::LengthPrefixed;
+            return true;
+        }
+        if (text == "datagram")
+        {
+            out = DecoderType::Datagram;
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_policy(const std::string& text, OverloadPolicy& out)
+    {
+        if (text == "pause_read")
+        {
+            out = OverloadPolicy::PauseRead;
+        }
+        else if (text == "drop_oldest")
+        {
+            out = OverloadPolicy::DropOldest;
+        }
+        else if (text == "drop_newest")
+        {
+            out = OverloadPolicy::DropNewest;
+        }
+        else if (text == "spill_to_disk")
+        {
+            out = OverloadPolicy::SpillToDisk;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // "host:port"
+    bool parse_address(const std::string& text, EndpointAddress& out)
+    {
+        std::string spec = trim(text);
+        size_t colon = spec.rfind(':');
+        if (colon == std::string::npos || colon == 0)
+        {
+            return false;
+        }
+        out.host = spec.substr(0, colon);
+        return parse_int(spec.substr(colon + 1), out.port) && out.port > 0 && out.port < 65536;
+    }
+
+    // "[udp:]host:port[|backup_host:port...][/decoder]"
+    bool parse_endpoint(const std::string& text, EndpointConfig& out)
+    {
+        std::string spec = trim(text);
+        out.transport = Transport::Tcp;
+        if (spec.compare(0, 4, "udp:") == 0)
+        {
+            out.transport = Transport::Udp;
+            spec = spec.substr(4);
+        }
+        else if (spec.compare(0, 4, "tcp:") == 0)
+        {
+            spec = spec.substr(4);
+        }
+
+        size_t slash = spec.find('/');
+        out.decoder = DecoderType::Line;
+        if (slash != std::string::npos)
+        {
+            if (!parse_decoder(spec.substr(slash + 1), out.decoder))
+            {
+                return false;
+            }
+            spec = spec.substr(0, slash);
+        }
+        if (out.decoder == DecoderType::Datagram && out.transport != Transport::Udp)
+        {
+            return false; // A byte stream has no datagram boundaries
+        }
+
+        out.backups.clear();
+        size_t start = 0;
+        bool primary = true;
+        while (start <= spec.size())
+        {
+            size_t end = spec.find('|', start);
+            if (end == std::string::npos)
+            {
+                end = spec.size();
+            }
+            EndpointAddress address;
+            if (!parse_address(spec.substr(start, end - start), address))
+            {
+                return false;
+            }
+            if (primary)
+            {
+                out.host = address.host;
+                out.port = address.port;
+                primary = false;
+            }
+            else
+            {
+                out.backups.push_back(address);
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+
+    // "endpoint;endpoint;...", may be empty when only listening
+    bool parse_endpoints(const std::string& text, std::vector<EndpointConfig>& out)
+    {
+        std::vector<EndpointConfig> endpoints;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t end = text.find(';', start);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            std::string item = trim(text.substr(start, end - start));
+            if (!item.empty())
+            {
+                EndpointConfig endpoint;
+                if (!parse_endpoint(item, endpoint))
+                {
+                    return false;
+                }
+                endpoints.push_back(endpoint);
+            }
+            start = end + 1;
+        }
+        out = endpoints;
+        return true;
+    }
+
+    // ",", "\t" or "space"
+    bool parse_delimiter(const std::string& text, char& out)
+    {
+        if (text.size() != 1 && text != "\\t" && text != "space")
+        {
+            return false;
+        }
+        out = (text == "\\t") ? '\t' : (text == "space") ? ' ' : text[0];
+        return true;
+    }
+
+    // A zero-based field index, or "none" for -1
+    bool parse_optional_field(const std::string& text, int& out)
+    {
+        if (text == "none")
+        {
+            out = -1;
+            return true;
+        }
+        return parse_int_in(text, out, 0);
+    }
+
+    // "contains:text", "prefix:text" or "field:N=text"
+    bool parse_filter_pattern(const std::string& text, FilterPattern& out)
+    {
+        size_t colon = text.find(':');
+        if (colon == std::string::npos)
+        {
+            return false;
+        }
+        std::string kind = text.substr(0, colon);
+        std::string rest = text.substr(colon + 1);
+        if (kind == "contains")
+        {
+            out.match = FilterMatch::Contains;
+            out.text = rest;
+        }
+        else if (kind == "prefix")
+        {
+            out.match = FilterMatch::Prefix;
+            out.text = rest;
+        }
+        else if (kind == "field")
+        {
+            size_t equals = rest.find('=');
+            if (equals == std::string::npos || !parse_size(rest.substr(0, equals), out.field))
+            {
+                return false;
+            }
+            out.match = FilterMatch::Field;
+            out.text = rest.substr(equals + 1);
+            return true; // An empty field is a valid value
+        }
+        else
+        {
+            return false;
+        }
+        return !out.text.empty();
+    }
+
+    // "pattern;pattern;...", may be empty to disable filtering
+    bool parse_filter_patterns(const std::string& text, std::vector<FilterPattern>& out)
+    {
+        std::vector<FilterPattern> patterns;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t end = text.find(';', start);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            std::string item = trim(text.substr(start, end - start));
+            if (!item.empty())
+            {
+                FilterPattern pattern;
+                if (!parse_filter_pattern(item, pattern))
+                {
+                    return false;
+                }
+                patterns.push_back(pattern);
+            }
+            start = end + 1;
+        }
+        out = patterns;
+        return true;
+    }
+
+    struct Setting
+    {
+        const char* key;
+        bool (*apply)(IngestionConfig& config, const std::string& value);
+    };
+
+    const Setting SETTINGS[] = {
+        {"endpoints", [](IngestionConfig& c, const std::string& v) { return parse_endpoints(v, c.endpoints); }},
+        {"ingestion_cores", [](IngestionConfig& c, const std::string& v)
+            {
+                std::vector<int> cores;
+                if (!parse_core_list(v, cores) || cores.empty())
+                {
+                    return false;
+                }
+                c.ingestion_cores = cores;
+                return true;
+            }},
+        {"consumer_cores", [](IngestionConfig& c, const std::string& v) { return parse_core_list(v, c.consumer_cores); }},
+        {"buffer_size", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.buffer_size, 1); }},
+        {"pool_size", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.pool_size, 1); }},
+        {"max_frame_size", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.max_frame_size, 1); }},
+        {"max_events", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.max_events, 1); }},
+        {"socket_rcvbuf", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.socket_rcvbuf, 1); }},
+        {"epoll_timeout_ms", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.epoll_timeout_ms, 0); }},
+        {"wait_policy", [](IngestionConfig& c, const std::string& v)
+            {
+                if (v == "epoll")
+                {
+                    c.wait_policy = WaitPolicy::Epoll;
+                    return true;
+                }
+                if (v == "busy_poll")
+                {
+                    c.wait_policy = WaitPolicy::BusyPoll;
+                    return true;
+                }
+                return false;
+            }},
+        {"listen.address", [](IngestionConfig& c, const std::string& v)
+            {
+                if (v.empty())
+                {
+                    c.listen.host.clear();
+                    return true;
+                }
+                EndpointConfig endpoint;
+                if (!parse_endpoint(v, endpoint) || !endpoint.backups.empty() ||
+                    endpoint.transport != Transport::Tcp)
+                {
+                    return false;
+                }
+                c.listen.host = endpoint.host;
+                c.listen.port = endpoint.port;
+                c.listen.decoder = endpoint.decoder;
+                return true;
+            }},
+        {"listen.backlog", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.listen.backlog, 1); }},
+        {"listen.incoming_cpu", [](IngestionConfig& c, const std::string& v) { return parse_bool(v, c.listen.incoming_cpu); }},
+        {"reconnect.enabled", [](IngestionConfig& c, const std::string& v) { return parse_bool(v, c.reconnect.enabled); }},
+        {"reconnect.initial_ms", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.reconnect.initial_ms, 1); }},
+        {"reconnect.max_ms", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.reconnect.max_ms, 1); }},
+        {"reconnect.connect_timeout_ms", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.reconnect.connect_timeout_ms, 1); }},
+        {"reconnect.failover_after", [](IngestionConfig& c, const std::string& v) { return parse_int_in(v, c.reconnect.failover_after, 1); }},
+        {"udp.batch", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.udp.batch, 1, 1024); }},
+        {"udp.max_datagram", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.udp.max_datagram, 1, 65536); }},
+        {"udp.interface", [](IngestionConfig& c, const std::string& v)
+            {
+                if (v.empty())
+                {
+                    return false;
+                }
+                c.udp.interface = v;
+                return true;
+            }},
+        {"shm.name", [](IngestionConfig& c, const std::string& v)
+            {
+                if (!v.empty() && v[0] != '/')
+                {
+                    return false;
+                }
+                c.shm.name = v;
+                return true;
+            }},
+        {"shm.ring_bytes", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.shm.ring_bytes, 1); }},
+        {"shm.max_readers", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.shm.max_readers, 1, 64); }},
+        {"sharding.num_shards", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.sharding.num_shards); }},
+        {"sharding.key_delimiter", [](IngestionConfig& c, const std::string& v) { return parse_delimiter(v, c.sharding.key_delimiter); }},
+        {"sharding.key_field", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.sharding.key_field); }},
+        {"sharding.queue_capacity", [](IngestionConfig& c, const std::string& v) { return parse_size_in(v, c.sharding.queue_capacity, 1); }},
+        {"filter.patterns", [](IngestionConfig& c, const std::string& v) { return parse_filter_patterns(v, c.filter.patterns); }},
+        {"filter.action", [](IngestionConfig& c, const std::string& v)
+            {
+                if (v != "keep" && v != "drop")
+                {
+                    return false;
+                }
+                c.filter.keep_matching = v == "keep";
+                return true;
+            }},
+        {"filter.field_delimiter", [](IngestionConfig& c, const std::string& v) { return parse_delimiter(v, c.filter.field_delimiter); }},
+        {"memory.arena_bytes", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.memory.arena_bytes); }},
+        {"memory.huge_pages", [](IngestionConfig& c, const std::string& v) { return parse_bool(v, c.memory.huge_pages); }},
+        {"memory.prefault", [](IngestionConfig& c, const std::string& v) { return parse_bool(v, c.memory.prefault); }},
+        {"memory.lock", [](IngestionConfig& c, const std::string& v) { return parse_bool(v, c.memory.lock); }},
+        {"history.bytes_per_feed", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.history.bytes_per_feed); }},
+        {"capture.path", [](IngestionConfig& c, const std::string& v) { c.capture.path = v; return true; }},
+        {"aggregate.window_ms", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.aggregation.window_ms); }},
+        {"aggregate.slide_ms", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.aggregation.slide_ms); }},
+        {"aggregate.lateness_ms", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.aggregation.lateness_ms); }},
+        {"aggregate.delimiter", [](IngestionConfig& c, const std::string& v) { return parse_delimiter(v, c.aggregation.delimiter); }},
+        {"aggregate.key_field", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.aggregation.key_field); }},
+        {"aggregate.value_field", [](IngestionConfig& c, const std::string& v) { return parse_optional_field(v, c.aggregation.value_field); }},
+        {"aggregate.distinct_field", [](IngestionConfig& c, const std::string& v) { return parse_optional_field(v, c.aggregation.distinct_field); }},
+        {"flow.queue_high_watermark", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.flow_control.queue_high_watermark); }},
+        {"flow.queue_low_watermark", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.flow_control.queue_low_watermark); }},
+        {"flow.pool_high_watermark", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.flow_control.pool_high_watermark); }},
+        {"flow.pool_low_watermark", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.flow_control.pool_low_watermark); }},
+        {"flow.pool_max_size", [](IngestionConfig& c, const std::string& v) { return parse_size(v, c.flow_control.pool_max_size); }},
+        {"flow.policy", [](IngestionConfig& c, const std::string& v) { return parse_policy(v, c.flow_control.policy); }},
+        {"flow.spill_path", [](IngestionConfig& c, const std::string& v)
+            {
+                if (v.empty())
+                {
+                    return false;
+                }
+                c.flow_control.spill_path = v;
+                return true;
+            }},
+    };
+
+    // "flow.queue_high_watermark" -> "INGESTION_FLOW_QUEUE_HIGH_WATERMARK"
+    std::string env_name(const char* key)
+    {
+        std::string name = "INGESTION_";
+        for (const char* p = key; *p != '\0'; ++p)
+        {
+            name += (*p == '.') ? '_' : static_cast<char>(toupper(static_cast<unsigned char>(*p)));
+        }
+        return name;
+    }
+}
+
+bool set_config_value(IngestionConfig& config, const std::string& key, const std::string& value)
+{
+    for (const Setting& setting : SETTINGS)
+    {
+        if (key == setting.key)
+        {
+            if (!setting.apply(config, trim(value)))
+            {
+                std::cerr << "Invalid value for " << key << ": '" << value << "'\n";
+                return false;
+            }
+            return true;
+        }
+    }
+    std::cerr << "Unknown configuration key: " << key << "\n";
+    return false;
+}
+
+bool load_config_file(const std::string& path, IngestionConfig& config)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Failed to open config file " << path << "\n";
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        ++line_number;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+        line = trim(line);
+        if (line.empty())
+        {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            std::cerr << path << ":" << line_number << ": expected key = value\n";
+            ok = false;
+            continue;
+        }
+        if (!set_config_value(config, trim(line.substr(0, equals)), line.substr(equals + 1)))
+        {
+            std::cerr << path << ":" << line_number << ": setting ignored\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool apply_env_overrides(IngestionConfig& config)
+{
+    bool ok = true;
+    for (const Setting& setting : SETTINGS)
+    {
+        const char* value = getenv(env_name(setting.key).c_str());
+        if (value != nullptr && !set_config_value(config, setting.key, value))
+        {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool apply_cli_overrides(int argc, char* argv[], IngestionConfig& config)
+{
+    bool ok = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            continue;
+        }
+        size_t equals = arg.find('=');
+        if (equals == std::string::npos)
+        {
+            continue;
+        }
+        std::string key = arg.substr(2, equals - 2);
+        if (key == "config")
+        {
+            continue;
+        }
+        if (!set_config_value(config, key, arg.substr(equals + 1)))
+        {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool load_config(int argc, char* argv[], IngestionConfig& config)
+{
+    config = get_default_config();
+
+    std::string path;
+    if (const char* env_path = getenv("INGESTION_CONFIG"))
+    {
+        path = env_path;
+    }
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--config=", 9) == 0)
+        {
+            path = argv[i] + 9;
+        }
+    }
+
+    bool ok = true;
+    if (!path.empty())
+    {
+        ok = load_config_file(path, config) && ok;
+    }
+    ok = apply_env_overrides(config) && ok;
+    ok = apply_cli_overrides(argc, argv, config) && ok;
+    return ok;
+}
+
+bool parse_core_list(const std::string& text, std::vector<int>& cores)
+{
+    std::vector<int> parsed;
+    if (trim(text).empty())
+    {
+        cores.clear();
+        return true;
+    }
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        int core = 0;
+        if (!parse_int(trim(text.substr(start, end - start)), core) || core < 0)
+        {
+            return false;
+        }
+        parsed.push_back(core);
+        start = end + 1;
+    }
+    cores = parsed;
+    return true;
+}
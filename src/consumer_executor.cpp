@@ -0,0 +1,146 @@
+// src/consumer_executor.cpp
+
+#include "ingestion/consumer_executor.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <iostream>
+
+namespace
+{
+    thread_local ConsumerExecutor* current_executor = nullptr;
+    thread_local size_t current_worker_index = 0;
+}
+
+void ConsumerTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+    ConsumerExecutor* executor = handle.promise().executor;
+    handle.destroy();
+    if (executor != nullptr)
+    {
+        executor->task_finished();
+    }
+}
+
+ConsumerExecutor::ConsumerExecutor(const std::vector<int>& cores)
+{
+    const size_t count = cores.empty() ? 1 : cores.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        workers_.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        int core = cores.empty() ? -1 : cores[i];
+        workers_[i]->thread = std::thread(&ConsumerExecutor::run, this, i, core);
+    }
+}
+
+ConsumerExecutor::~ConsumerExecutor()
+{
+    stopping_.store(true, std::memory_order_release);
+    for (auto& worker : workers_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->ready.notify_all();
+    }
+    for (auto& worker : workers_)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+ConsumerExecutor* ConsumerExecutor::current()
+{
+    return current_executor;
+}
+
+size_t ConsumerExecutor::current_worker()
+{
+    return current_worker_index;
+}
+
+void ConsumerExecutor::spawn(ConsumerTask task, size_t worker)
+{
+    if (worker >= workers_.size())
+    {
+        worker = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    }
+    std::coroutine_handle<ConsumerTask::promise_type> handle = task.handle_;
+    task.handle_ = nullptr;
+    handle.promise().executor = this;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex_);
+        ++live_tasks_;
+    }
+    schedule(handle, worker);
+}
+
+void ConsumerExecutor::schedule(std::coroutine_handle<> handle, size_t worker)
+{
+    Worker& target = *workers_[worker % workers_.size()];
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.run_queue.push_back(handle);
+    }
+    target.ready.notify_one();
+}
+
+void ConsumerExecutor::wait()
+{
+    std::unique_lock<std::mutex> lock(tasks_mutex_);
+    tasks_done_.wait(lock, [this]() { return live_tasks_ == 0; });
+}
+
+void ConsumerExecutor::task_finished()
+{
+    std::lock_guard<std::mutex> lock(tasks_mutex_);
+    if (--live_tasks_ == 0)
+    {
+        tasks_done_.notify_all();
+    }
+}
+
+void ConsumerExecutor::run(size_t index, int core)
+{
+    if (core >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(core, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+        {
+            std::cerr << "Error setting consumer worker affinity to core " << core << "\n";
+        }
+    }
+    current_executor = this;
+    current_worker_index = index;
+
+    Worker& worker = *workers_[index];
+    std::deque<std::coroutine_handle<>> batch;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.ready.wait(lock, [this, &worker]()
+            {
+                return !worker.run_queue.empty() || stopping_.load(std::memory_order_acquire);
+            });
+            if (worker.run_queue.empty())
+            {
+                break; // Stopping with nothing left to run
+            }
+            batch.swap(worker.run_queue);
+        }
+        for (std::coroutine_handle<> handle : batch)
+        {
+            handle.resume();
+        }
+        batch.clear();
+    }
+}
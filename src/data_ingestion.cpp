@@ -1,9 +1,15 @@
 // src/data_ingestion.cpp
 
 #include "ingestion/data_ingestion.hpp"
+#include "ingestion/spill_file.hpp"
+#include "ingestion/capture_file.hpp"
+#include "ingestion/datagram_socket.hpp"
+#include "ingestion/decoder.hpp"
+#include "ingestion/timestamper.hpp"
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
@@ -13,21 +19,167 @@
 #include <chrono>
 #include <pthread.h>
 #include <sched.h>
+#include <algorithm>
+#include <cstdint>
 
-// Helper function to set a socket to non-blocking mode
-bool set_nonblocking(int fd)
+// Feed connection, owned by a single ingest thread and registered with its epoll
+// instance through data.ptr
+struct FeedConnection
 {
-    int flags;
-    if ((flags = fcntl(fd, F_GETFL, 0)) == -1)
+    enum class Kind
     {
-        flags = 0;
+        Outbound,  // Dialed feed with reconnect and failover
+        Inbound,   // Producer accepted by this thread's listener; dropped when it closes
+        Listener   // This thread's SO_REUSEPORT listening socket
+    };
+
+    enum class State
+    {
+        Backoff,     // Waiting for deadline_ms before the next connect attempt
+        Connecting,  // Non-blocking connect in flight until deadline_ms
+        Connected,
+        Finished
+    };
+
+    Kind kind = Kind::Outbound;
+    Transport transport = Transport::Tcp;
+    uint32_t feed_id = 0;
+    DataIngestion::FeedCounters* counters = nullptr;
+    std::vector<EndpointAddress> addresses;  // Primary first, then backups
+    size_t address_index = 0;
+    State state = State::Backoff;
+    int fd = -1;
+    bool readable = false;       // Edge-triggered socket may still hold unread data
+    uint64_t deadline_ms = 0;
+    uint64_t backoff_ms = 0;
+    int consecutive_failures = 0;
+    uint32_t socket_drops = 0;   // Last SO_RXQ_OVFL value; the kernel counts per socket
+    uint32_t capture_stream = 0; // Capture stream id of this connection; 0 until its first capture
+    FrameDecoder decoder;
+};
+
+// Per-thread ingest state, owned by a single ingest thread
+struct IngestThreadState
+{
+    size_t thread_index = 0;
+    int epoll_fd = -1;
+    std::vector<std::unique_ptr<FeedConnection>> connections;
+    uint64_t rng = 0;         // xorshift state for reconnect jitter
+    bool overloaded = false;  // Between crossing a high watermark and falling below the low ones
+    bool paused = false;      // Sockets deliberately left unread under PauseRead
+    std::unique_ptr<SpillFile> spill;
+    std::unique_ptr<CaptureWriter> capture; // Raw received bytes, when capture.path is set
+    std::unique_ptr<ShmRingWriter> shm; // This thread's ring when publishing to shared memory
+    DatagramBatch datagrams;  // recvmmsg buffers, allocated on the thread's first UDP feed
+
+    // Thread-local copy of the runtime-tunable settings
+    uint64_t tunables_generation = ~uint64_t(0);
+    FlowControlConfig flow;
+    ReconnectConfig reconnect;
+    int epoll_timeout_ms = 1000;
+    WaitPolicy wait_policy = WaitPolicy::Epoll;
+    int socket_rcvbuf = 0;
+};
+
+namespace
+{
+    // Reads per connection before the loop moves on, so one busy feed cannot starve the rest
+    const int MAX_READS_PER_PASS = 16;
+
+    // Accepts per listener before the loop moves on to reading
+    const int MAX_ACCEPTS_PER_PASS = 64;
+
+    IngestionConfig legacy_config(const std::string& ip, int port, const std::vector<int>& ingestion_thread_cores)
+    {
+        IngestionConfig config;
+        config.endpoints.push_back({ip, port, DecoderType::Line, Transport::Tcp, {}});
+        config.ingestion_cores = ingestion_thread_cores;
+        return config;
+    }
+
+    uint64_t monotonic_ms()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    uint64_t next_random(uint64_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Single-writer counter increment without a locked RMW
+    void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::string format_address(const EndpointAddress& address)
+    {
+        return address.host + ":" + std::to_string(address.port);
+    }
+}
+
+DataIngestion::DataIngestion(const IngestionConfig& config)
+    : config_(config), running_(false),
+      arena_(config.memory.arena_bytes > 0 ? std::make_shared<Arena>(config.memory) : nullptr),
+      data_queue_(arena_.get()),
+      memory_pool_(config.pool_size, config.flow_control.pool_max_size, arena_), tunables_(config)
+{
+    filter_.compile(config_.filter);
+
+    const size_t history_bytes = config_.history.bytes_per_feed;
+    for (size_t i = 0; i < config_.endpoints.size(); ++i)
+    {
+        feed_counters_.emplace_back(new FeedCounters());
+        if (history_bytes > 0)
+        {
+            feed_history_.emplace_back(new HistoryBuffer(history_bytes, arena_.get()));
+        }
+    }
+    if (!config_.listen.host.empty())
+    {
+        for (size_t i = 0; i < config_.ingestion_cores.size(); ++i)
+        {
+            listener_counters_.emplace_back(new FeedCounters());
+            if (history_bytes > 0)
+            {
+                listener_history_.emplace_back(new HistoryBuffer(history_bytes, arena_.get()));
+            }
+        }
+    }
+
+    if (!config_.shm.name.empty())
+    {
+        shm_.reset(new ShmSegment());
+        if (!shm_->create(config_.shm.name, config_.ingestion_cores.size(), config_.shm.ring_bytes,
+                          config_.shm.max_readers))
+        {
+            std::cerr << "Shared-memory output disabled; records stay in process\n";
+            shm_.reset();
+        }
+    }
+
+    const ShardingConfig& sharding = config_.sharding;
+    if (sharding.num_shards > 0)
+    {
+        shard_lanes_.resize(config_.ingestion_cores.size());
+        for (auto& lanes : shard_lanes_)
+        {
+            for (size_t shard = 0; shard < sharding.num_shards; ++shard)
+            {
+                lanes.emplace_back(new ShardLane(sharding.queue_capacity, arena_.get()));
+            }
+        }
+        shard_cursors_.reset(new ShardCursor[sharding.num_shards]);
     }
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
 }
 
 DataIngestion::DataIngestion(const std::string& ip, int port, const std::vector<int>& ingestion_thread_cores)
-    : ip_(ip), port_(port), ingestion_thread_cores_(ingestion_thread_cores),
-      running_(false), epoll_fd_(-1), sock_fd_(-1), memory_pool_(10000)
+    : DataIngestion(legacy_config(ip, port, ingestion_thread_cores))
 {
 }
 
@@ -38,38 +190,127 @@ DataIngestion::~DataIngestion()
 
 void DataIngestion::start()
 {
+    input_finished_.store(false, std::memory_order_release);
     running_.store(true, std::memory_order_release);
-    for (const auto& core : ingestion_thread_cores_)
+    active_threads_.store(config_.ingestion_cores.size(), std::memory_order_release);
+    for (size_t i = 0; i < config_.ingestion_cores.size(); ++i)
     {
-        ingest_threads_.emplace_back(&DataIngestion::ingest, this, core);
+        ingest_threads_.emplace_back(&DataIngestion::ingest, this, i, config_.ingestion_cores[i]);
     }
 }
 
 void DataIngestion::stop()
 {
-    if (running_.load(std::memory_order_acquire))
+    // Threads may already have cleared running_ themselves (STOP message), so always join
+    running_.store(false, std::memory_order_release);
+    for (auto& thread : ingest_threads_)
     {
-        running_.store(false, std::memory_order_release);
-        for (auto& thread : ingest_threads_)
+        if (thread.joinable())
         {
-            if (thread.joinable())
-            {
-                thread.join();
-            }
+            thread.join();
+        }
+    }
+    ingest_threads_.clear();
+}
+
+bool DataIngestion::is_running() const
+{
+    return running_.load(std::memory_order_acquire);
+}
+
+bool DataIngestion::reload(const IngestionConfig& config)
+{
+    bool structural_unchanged = true;
+    auto check = [&structural_unchanged](bool same, const char* name)
+    {
+        if (!same)
+        {
+            std::cerr << "reload: " << name << " is structural and requires a restart; keeping current value\n";
+            structural_unchanged = false;
         }
-        ingest_threads_.clear();
+    };
+    check(config.ingestion_cores == config_.ingestion_cores, "ingestion_cores");
+    check(config.buffer_size == config_.buffer_size, "buffer_size");
+    check(config.pool_size == config_.pool_size, "pool_size");
+    check(config.max_frame_size == config_.max_frame_size, "max_frame_size");
+    check(config.max_events == config_.max_events, "max_events");
+    check(config.sharding.num_shards == config_.sharding.num_shards &&
+          config.sharding.key_delimiter == config_.sharding.key_delimiter &&
+          config.sharding.key_field == config_.sharding.key_field &&
+          config.sharding.queue_capacity == config_.sharding.queue_capacity, "sharding");
+    check(config.flow_control.pool_max_size == config_.flow_control.pool_max_size, "flow.pool_max_size");
+    check(config.flow_control.spill_path == config_.flow_control.spill_path, "flow.spill_path");
+    check(config.listen.host == config_.listen.host && config.listen.port == config_.listen.port &&
+          config.listen.decoder == config_.listen.decoder && config.listen.backlog == config_.listen.backlog &&
+          config.listen.incoming_cpu == config_.listen.incoming_cpu, "listen");
+    check(config.udp.batch == config_.udp.batch && config.udp.max_datagram == config_.udp.max_datagram &&
+          config.udp.interface == config_.udp.interface, "udp");
+    check(config.filter.keep_matching == config_.filter.keep_matching &&
+          config.filter.field_delimiter == config_.filter.field_delimiter &&
+          config.filter.patterns.size() == config_.filter.patterns.size() &&
+          std::equal(config.filter.patterns.begin(), config.filter.patterns.end(), config_.filter.patterns.begin(),
+                     [](const FilterPattern& a, const FilterPattern& b)
+                     {
+                         return a.match == b.match && a.text == b.text && a.field == b.field;
+                     }), "filter");
+    check(config.history.bytes_per_feed == config_.history.bytes_per_feed, "history");
+    check(config.capture.path == config_.capture.path, "capture");
+    check(config.memory.arena_bytes == config_.memory.arena_bytes && config.memory.huge_pages == config_.memory.huge_pages &&
+          config.memory.prefault == config_.memory.prefault && config.memory.lock == config_.memory.lock, "memory");
+    check(config.shm.name == config_.shm.name && config.shm.ring_bytes == config_.shm.ring_bytes &&
+          config.shm.max_readers == config_.shm.max_readers, "shm");
+    check(config.endpoints.size() == config_.endpoints.size() &&
+          std::equal(config.endpoints.begin(), config.endpoints.end(), config_.endpoints.begin(),
+                     [](const EndpointConfig& a, const EndpointConfig& b)
+                     {
+                         return a.host == b.host && a.port == b.port && a.decoder == b.decoder &&
+                                a.transport == b.transport && a.backups.size() == b.backups.size() &&
+                                std::equal(a.backups.begin(), a.backups.end(), b.backups.begin(),
+                                           [](const EndpointAddress& x, const EndpointAddress& y)
+                                           {
+                                               return x.host == y.host && x.port == y.port;
+                                           });
+                     }), "endpoints");
+
+    {
+        std::lock_guard<std::mutex> lock(tunables_mutex_);
+        tunables_.socket_rcvbuf = config.socket_rcvbuf;
+        tunables_.epoll_timeout_ms = config.epoll_timeout_ms;
+        tunables_.wait_policy = config.wait_policy;
+        tunables_.reconnect = config.reconnect;
+        tunables_.flow_control.queue_high_watermark = config.flow_control.queue_high_watermark;
+        tunables_.flow_control.queue_low_watermark = config.flow_control.queue_low_watermark;
+        tunables_.flow_control.pool_high_watermark = config.flow_control.pool_high_watermark;
+        tunables_.flow_control.pool_low_watermark = config.flow_control.pool_low_watermark;
+        tunables_.flow_control.policy = config.flow_control.policy;
     }
+    tunables_generation_.fetch_add(1, std::memory_order_release);
+    return structural_unchanged;
+}
 
-    if (sock_fd_ != -1)
+void DataIngestion::refresh_tunables(IngestThreadState& state)
+{
+    uint64_t generation = tunables_generation_.load(std::memory_order_acquire);
+    if (generation == state.tunables_generation)
     {
-        close(sock_fd_);
-        sock_fd_ = -1;
+        return;
     }
+    std::lock_guard<std::mutex> lock(tunables_mutex_);
+    state.flow = tunables_.flow_control;
+    state.reconnect = tunables_.reconnect;
+    state.epoll_timeout_ms = tunables_.epoll_timeout_ms;
+    state.wait_policy = tunables_.wait_policy;
+    state.socket_rcvbuf = tunables_.socket_rcvbuf;
+    state.tunables_generation = generation;
 
-    if (epoll_fd_ != -1)
+    // Switching to SpillToDisk at runtime opens the spill file lazily
+    if (state.flow.policy == OverloadPolicy::SpillToDisk && !state.spill)
     {
-        close(epoll_fd_);
-        epoll_fd_ = -1;
+        state.spill.reset(new SpillFile());
+        if (!state.spill->open(config_.flow_control.spill_path + "." + std::to_string(state.thread_index)))
+        {
+            state.spill.reset();
+        }
     }
 }
 
@@ -78,12 +319,310 @@ bool DataIngestion::get_data(std::shared_ptr<DataRecord>& record)
     return data_queue_.dequeue(record);
 }
 
-void DataIngestion::ingest(int cpu_core)
+bool DataIngestion::get_data(size_t shard, std::shared_ptr<DataRecord>& record)
+{
+    if (shard >= config_.sharding.num_shards)
+    {
+        return false;
+    }
+    // Round-robin over the lanes feeding this shard so no ingestion thread starves
+    ShardCursor& cursor = shard_cursors_[shard];
+    const size_t lanes = shard_lanes_.size();
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        size_t lane = cursor.next_lane;
+        cursor.next_lane = (lane + 1 == lanes) ? 0 : lane + 1;
+        if (shard_lanes_[lane][shard]->queue.try_dequeue(record))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t DataIngestion::num_shards() const
+{
+    return config_.sharding.num_shards;
+}
+
+ShardStats DataIngestion::get_shard_stats() const
+{
+    ShardStats stats;
+    stats.routed.assign(config_.sharding.num_shards, 0);
+    stats.depth.assign(config_.sharding.num_shards, 0);
+    for (const auto& lanes : shard_lanes_)
+    {
+        for (size_t shard = 0; shard < config_.sharding.num_shards; ++shard)
+        {
+            stats.routed[shard] += lanes[shard]->routed.load(std::memory_order_relaxed);
+            stats.depth[shard] += lanes[shard]->queue.size();
+        }
+    }
+
+    uint64_t total = 0;
+    uint64_t max_routed = 0;
+    for (uint64_t routed : stats.routed)
+    {
+        total += routed;
+        max_routed = std::max(max_routed, routed);
+    }
+    if (total > 0)
+    {
+        double mean = static_cast<double>(total) / static_cast<double>(config_.sharding.num_shards);
+        stats.skew = static_cast<double>(max_routed) / mean;
+    }
+    return stats;
+}
+
+void DataIngestion::recycle(std::shared_ptr<DataRecord> record)
+{
+    if (record)
+    {
+        memory_pool_.release(std::move(record));
+    }
+}
+
+FlowControlStats DataIngestion::get_flow_control_stats() const
+{
+    FlowControlStats stats;
+    stats.pauses = pauses_.load(std::memory_order_relaxed);
+    stats.dropped_newest = dropped_newest_.load(std::memory_order_relaxed);
+    stats.dropped_oldest = dropped_oldest_.load(std::memory_order_relaxed);
+    stats.spilled = spilled_.load(std::memory_order_relaxed);
+    stats.unspilled = unspilled_.load(std::memory_order_relaxed);
+    stats.queue_depth = queue_depth();
+    stats.pool_in_use = memory_pool_.in_use();
+    return stats;
+}
+
+std::vector<ConnectionStats> DataIngestion::get_connection_stats() const
+{
+    std::vector<ConnectionStats> stats;
+    for (size_t feed = 0; feed < feed_counters_.size(); ++feed)
+    {
+        const FeedCounters& counters = *feed_counters_[feed];
+        const EndpointConfig& endpoint = config_.endpoints[feed];
+        ConnectionStats entry;
+        entry.feed_id = feed;
+        size_t address_index = counters.address_index.load(std::memory_order_relaxed);
+        entry.address = address_index == 0 ? format_address({endpoint.host, endpoint.port})
+                                           : format_address(endpoint.backups[address_index - 1]);
+        int state = counters.state.load(std::memory_order_relaxed);
+        entry.connected = state == static_cast<int>(FeedConnection::State::Connected);
+        entry.finished = state == static_cast<int>(FeedConnection::State::Finished);
+        entry.connects = counters.connects.load(std::memory_order_relaxed);
+        entry.connect_failures = counters.connect_failures.load(std::memory_order_relaxed);
+        entry.disconnects = counters.disconnects.load(std::memory_order_relaxed);
+        entry.failovers = counters.failovers.load(std::memory_order_relaxed);
+        entry.bytes_received = counters.bytes_received.load(std::memory_order_relaxed);
+        entry.records = counters.records.load(std::memory_order_relaxed);
+        entry.filtered = counters.filtered.load(std::memory_order_relaxed);
+        entry.datagrams = counters.datagrams.load(std::memory_order_relaxed);
+        entry.bad_datagrams = counters.bad_datagrams.load(std::memory_order_relaxed);
+        entry.kernel_drops = counters.kernel_drops.load(std::memory_order_relaxed);
+        stats.push_back(entry);
+    }
+
+    if (!listener_counters_.empty())
+    {
+        ConnectionStats entry;
+        entry.feed_id = config_.endpoints.size();
+        entry.address = format_address({config_.listen.host, config_.listen.port});
+        for (const auto& counters : listener_counters_)
+        {
+            entry.connects += counters->connects.load(std::memory_order_relaxed);
+            entry.disconnects += counters->disconnects.load(std::memory_order_relaxed);
+            entry.bytes_received += counters->bytes_received.load(std::memory_order_relaxed);
+            entry.records += counters->records.load(std::memory_order_relaxed);
+            entry.filtered += counters->filtered.load(std::memory_order_relaxed);
+        }
+        entry.connected = entry.connects > entry.disconnects;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+ArenaStats DataIngestion::get_arena_stats() const
+{
+    return arena_ ? arena_->stats() : ArenaStats();
+}
+
+bool DataIngestion::get_history(uint32_t feed_id, uint64_t from_ms, uint64_t to_ms, std::vector<DataRecord>& records,
+                                size_t max_records) const
+{
+    if (feed_id < feed_history_.size())
+    {
+        feed_history_[feed_id]->range(from_ms, to_ms, records, max_records);
+        return true;
+    }
+    if (feed_id != config_.endpoints.size() || listener_history_.empty())
+    {
+        return false;
+    }
+
+    // Each thread's ring is in order on its own; interleave them by timestamp
+    size_t first = records.size();
+    for (const auto& history : listener_history_)
+    {
+        history->range(from_ms, to_ms, records, max_records);
+    }
+    std::stable_sort(records.begin() + first, records.end(),
+                     [](const DataRecord& a, const DataRecord& b)
+                     {
+                         return a.timestamp < b.timestamp;
+                     });
+    if (records.size() - first > max_records)
+    {
+        records.erase(records.begin() + first + max_records, records.end());
+    }
+    return true;
+}
+
+RecordBatchAwaitable DataIngestion::next_batch(size_t max_records)
+{
+    return RecordBatchAwaitable(*this, SIZE_MAX, max_records);
+}
+
+RecordBatchAwaitable DataIngestion::next_shard_batch(size_t shard, size_t max_records)
+{
+    return RecordBatchAwaitable(*this, shard, max_records);
+}
+
+size_t DataIngestion::take_batch(size_t queue, std::vector<std::shared_ptr<DataRecord>>& batch, size_t max_records)
+{
+    size_t taken = 0;
+    std::shared_ptr<DataRecord> record;
+    while (taken < max_records && (queue == SIZE_MAX ? get_data(record) : get_data(queue, record)))
+    {
+        batch.push_back(std::move(record));
+        ++taken;
+    }
+    return taken;
+}
+
+bool DataIngestion::park(RecordBatchAwaitable& awaiter, std::coroutine_handle<> handle)
+{
+    // Announce the waiter before the final check; pairs with the fence in notify_consumers()
+    parked_count_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::lock_guard<std::mutex> lock(parked_mutex_);
+    if (take_batch(awaiter.queue_, awaiter.batch_, awaiter.max_records_) > 0 ||
+        input_finished_.load(std::memory_order_acquire))
+    {
+        parked_count_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    ConsumerExecutor* executor = ConsumerExecutor::current();
+    parked_.push_back({&awaiter, handle, executor, executor != nullptr ? ConsumerExecutor::current_worker() : 0});
+    return true;
+}
+
+void DataIngestion::notify_consumers()
+{
+    // Order the records just published before reading the waiter count
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_count_.load(std::memory_order_relaxed) > 0)
+    {
+        wake_consumers();
+    }
+}
+
+void DataIngestion::wake_consumers()
+{
+    std::vector<ParkedConsumer> ready;
+    {
+        std::lock_guard<std::mutex> lock(parked_mutex_);
+        const bool finished = input_finished_.load(std::memory_order_acquire);
+        auto still_parked = parked_.begin();
+        for (ParkedConsumer& parked : parked_)
+        {
+            // Hand over the batch here, under the mutex, so a resumed consumer never comes
+            // back empty-handed while shard lanes keep a single dequeuing thread at a time
+            RecordBatchAwaitable& awaiter = *parked.awaiter;
+            if (take_batch(awaiter.queue_, awaiter.batch_, awaiter.max_records_) > 0 || finished)
+            {
+                ready.push_back(parked);
+            }
+            else
+            {
+                *still_parked++ = parked;
+            }
+        }
+        parked_.erase(still_parked, parked_.end());
+        parked_count_.fetch_sub(ready.size(), std::memory_order_relaxed);
+    }
+
+    for (ParkedConsumer& parked : ready)
+    {
+        if (parked.executor != nullptr)
+        {
+            parked.executor->schedule(parked.handle, parked.worker);
+        }
+        else
+        {
+            parked.handle.resume();
+        }
+    }
+}
+
+bool RecordBatchAwaitable::await_ready()
+{
+    return ingestion_.take_batch(queue_, batch_, max_records_) > 0 ||
+           ingestion_.input_finished_.load(std::memory_order_acquire);
+}
+
+bool RecordBatchAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    return ingestion_.park(*this, handle);
+}
+
+std::vector<std::shared_ptr<DataRecord>> RecordBatchAwaitable::await_resume()
+{
+    if (batch_.empty())
+    {
+        // Finished: pick up anything published just before the last ingest thread exited
+        ingestion_.take_batch(queue_, batch_, max_records_);
+    }
+    return std::move(batch_);
+}
+
+void DataIngestion::publish(size_t thread_index, std::shared_ptr<DataRecord> record)
+{
+    if (config_.sharding.num_shards == 0)
+    {
+        data_queue_.enqueue(std::move(record));
+        return;
+    }
+
+    std::string_view key = extract_shard_key(record->message, config_.sharding.key_delimiter, config_.sharding.key_field);
+    size_t shard = shard_for_hash(hash_shard_key(key), config_.sharding.num_shards);
+    ShardLane& lane = *shard_lanes_[thread_index][shard];
+
+    // A full lane blocks this thread, which stops reading the socket and lets TCP push back.
+    // The lane's consumer may still be parked from when it was empty, and the batch that
+    // filled it is not announced until the recv loop ends, so wake it before waiting.
+    while (!lane.queue.try_enqueue(record))
+    {
+        notify_consumers();
+        if (!running_.load(std::memory_order_acquire))
+        {
+            // Shutting down with the lane still full; account for the record
+            dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+            memory_pool_.release(std::move(record));
+            return;
+        }
+        std::this_thread::yield();
+    }
+    lane.routed.store(lane.routed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void DataIngestion::ingest(size_t thread_index, int cpu_core)
 {
     // Set thread affinity to specified CPU core
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
-    CPU_SET(8, &cpuset); // Pin to specified CPU core
+    CPU_SET(cpu_core, &cpuset); // Pin to specified CPU core
     pthread_t thread = pthread_self();
     int rc = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
     if (rc != 0)
@@ -95,84 +634,118 @@ void DataIngestion::ingest(int cpu_core)
         std::cout << "Ingestion thread pinned to CPU " << cpu_core << "\n";
     }
 
-    // Create socket
-    sock_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock_fd_ < 0)
+    IngestThreadState state;
+    state.thread_index = thread_index;
+    state.rng = 0x9E3779B97F4A7C15ull ^ (monotonic_ms() << 8) ^ thread_index;
+    refresh_tunables(state);
+    if (shm_)
     {
-        std::cerr << "Socket creation failed\n";
-        return;
+        state.shm.reset(new ShmRingWriter(*shm_, thread_index));
     }
-
-    // Set socket to non-blocking
-    if (!set_nonblocking(sock_fd_))
+    if (!config_.capture.path.empty())
     {
-        std::cerr << "Failed to set socket to non-blocking\n";
-        close(sock_fd_);
-        sock_fd_ = -1;
-        return;
+        state.capture.reset(new CaptureWriter());
+        if (!state.capture->open(config_.capture.path + "." + std::to_string(thread_index)))
+        {
+            state.capture.reset();
+        }
     }
 
-    // Increase socket receive buffer size
-    int recv_buffer_size = 8 * 1024 * 1024; // 8MB
-    if (setsockopt(sock_fd_, SOL_SOCKET, SO_RCVBUF, &recv_buffer_size, sizeof(recv_buffer_size)) < 0)
+    // Per-thread epoll instance and receive buffer
+    std::vector<char, ArenaAllocator<char>> buffer(config_.buffer_size, ArenaAllocator<char>(arena_));
+    state.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (state.epoll_fd == -1)
     {
-        std::cerr << "Failed to set SO_RCVBUF\n";
+        std::cerr << "epoll_create1 failed: " << strerror(errno) << "\n";
     }
-
-    // Prepare server address
-    struct sockaddr_in serv_addr;
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port_);
-    if (inet_pton(AF_INET, ip_.c_str(), &serv_addr.sin_addr) <= 0)
+    else
     {
-        std::cerr << "Invalid address/ Address not supported \n";
-        close(sock_fd_);
-        sock_fd_ = -1;
-        return;
+        // Feeds are spread round-robin across the ingestion threads
+        uint64_t now = monotonic_ms();
+        const size_t num_threads = config_.ingestion_cores.size();
+        for (size_t feed = thread_index; feed < config_.endpoints.size(); feed += num_threads)
+        {
+            const EndpointConfig& endpoint = config_.endpoints[feed];
+            std::unique_ptr<FeedConnection> conn(new FeedConnection());
+            conn->feed_id = static_cast<uint32_t>(feed);
+            conn->transport = endpoint.transport;
+            conn->counters = feed_counters_[feed].get();
+            conn->addresses.push_back({endpoint.host, endpoint.port});
+            conn->addresses.insert(conn->addresses.end(), endpoint.backups.begin(), endpoint.backups.end());
+            conn->decoder = FrameDecoder(endpoint.decoder, config_.max_frame_size);
+            open_connection(state, *conn, now);
+            state.connections.push_back(std::move(conn));
+        }
+        if (!config_.listen.host.empty())
+        {
+            open_listener(state, cpu_core);
+        }
+        std::cout << "Data Ingestion Module Started. Waiting to ingest data...\n";
     }
 
-    // Connect to server
-    struct epoll_event event;
-    int res = connect(sock_fd_, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
-    if (res == 0) {
-        // Connection established immediately
-        std::cout << "Connected to server immediately\n";
-        // Register for EPOLLIN events to start reading data
-        event.events = EPOLLIN | EPOLLET;
-    } else if (res < 0 && errno == EINPROGRESS) {
-        // Connection is in progress
-        std::cout << "Connection in progress\n";
-        // Register for EPOLLOUT events to detect when the socket becomes writable
-        event.events = EPOLLOUT | EPOLLET;
-    } else {
-        // An error occurred
-        std::cerr << "Connection Failed: " << strerror(errno) << "\n";
-        close(sock_fd_);
-        sock_fd_ = -1;
-        return;
-    }
+    // Event loop
+    std::vector<struct epoll_event> events(config_.max_events);
 
-    // Update epoll with the initial event settings
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sock_fd_, &event) == -1)
+    while (state.epoll_fd != -1 && running_.load(std::memory_order_acquire))
     {
-        std::cerr << "epoll_ctl failed\n";
-        close(sock_fd_);
-        sock_fd_ = -1;
-        close(epoll_fd_);
-        epoll_fd_ = -1;
-        return;
-    }
+        refresh_tunables(state);
+        uint64_t now = monotonic_ms();
 
-    std::cout << "Data Ingestion Module Started. Waiting to ingest data...\n";
+        // Fire due timers: reconnect attempts and connect timeouts
+        bool all_finished = true;
+        bool pending_reads = false;
+        uint64_t next_deadline = UINT64_MAX;
+        for (auto& conn : state.connections)
+        {
+            if (conn->state == FeedConnection::State::Backoff && conn->deadline_ms <= now)
+            {
+                open_connection(state, *conn, now);
+            }
+            else if (conn->state == FeedConnection::State::Connecting && conn->deadline_ms <= now)
+            {
+                std::cerr << "Feed " << conn->feed_id << ": connect to "
+                          << format_address(conn->addresses[conn->address_index]) << " timed out\n";
+                fail_connection(state, *conn, now);
+            }
+            if (conn->state == FeedConnection::State::Backoff || conn->state == FeedConnection::State::Connecting)
+            {
+                next_deadline = std::min(next_deadline, conn->deadline_ms);
+            }
+            // A listener never finishes on its own; only stop() ends a listening thread
+            all_finished = all_finished && conn->kind != FeedConnection::Kind::Listener &&
+                           conn->state == FeedConnection::State::Finished;
+            pending_reads = pending_reads || conn->readable;
+        }
 
-    // Event loop
-    const int MAX_EVENTS = 10000;
-    struct epoll_event events[MAX_EVENTS];
+        // Replay spilled records first so per-connection order is preserved
+        update_overload(state);
+        if (state.spill && !state.overloaded && !state.spill->empty())
+        {
+            unspill(state);
+        }
+        bool spill_pending = state.spill && !state.spill->empty();
+        if (all_finished && !spill_pending)
+        {
+            break;
+        }
 
-    while (running_.load(std::memory_order_acquire))
-    {
-        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, 1000); // 1 second timeout
+        // Poll quickly while there is deferred work waiting on the consumers
+        int timeout = state.epoll_timeout_ms;
+        if (state.wait_policy == WaitPolicy::BusyPoll || (pending_reads && !state.paused))
+        {
+            timeout = 0;
+        }
+        else if (state.paused || spill_pending)
+        {
+            timeout = 1;
+        }
+        else if (next_deadline != UINT64_MAX)
+        {
+            timeout = static_cast<int>(std::min<uint64_t>(next_deadline > now ? next_deadline - now : 0,
+                                                          static_cast<uint64_t>(timeout)));
+        }
+
+        int n = epoll_wait(state.epoll_fd, events.data(), config_.max_events, timeout);
         if (n < 0)
         {
             if (errno == EINTR)
@@ -183,123 +756,857 @@ void DataIngestion::ingest(int cpu_core)
             break;
         }
 
+        now = monotonic_ms();
         for (int i = 0; i < n; ++i)
         {
-            if (events[i].data.fd == sock_fd_)
+            FeedConnection& conn = *static_cast<FeedConnection*>(events[i].data.ptr);
+            if (conn.state == FeedConnection::State::Connecting)
             {
-                if (events[i].events & EPOLLOUT) 
-                {
-                    // Finalize the non-blocking connect
-                    int err = 0;
-                    socklen_t len = sizeof(err);
-                    if (getsockopt(sock_fd_, SOL_SOCKET, SO_ERROR, &err, &len) < 0) 
-                    {
-                        std::cerr << "getsockopt failed: " << strerror(errno) << "\n";
-                        running_.store(false, std::memory_order_release);
-                        break;
-                    }
-                    if (err != 0) 
-                    {
-                        std::cerr << "Connect failed with error: " << strerror(err) << "\n";
-                        running_.store(false, std::memory_order_release);
-                        break;
-                    }
-                    // Connection is established
-                    std::cout << "Connected to server\n";
-                    // Modify the events to listen for EPOLLIN
-                    struct epoll_event new_event;
-                    new_event.events = EPOLLIN | EPOLLET;
-                    new_event.data.fd = sock_fd_;
-                    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, sock_fd_, &new_event) == -1) 
-                    {
-                        std::cerr << "epoll_ctl modify failed: " << strerror(errno) << "\n";
-                        running_.store(false, std::memory_order_release);
-                        break;
-                    }
-                }
-                
-                if (events[i].events & EPOLLIN)
-                {
-                    // std::cout << "EPOLLIN event received\n"; // Optional: comment out to reduce verbosity
-                    while (true)
-                    {
-                        ssize_t count = recv(sock_fd_, buffer_, BUFFER_SIZE, 0);
-                        if (count == -1)
-                        {
-                            if (errno == EAGAIN || errno == EWOULDBLOCK)
-                            {
-                                // All data read
-                                break;
-                            }
-                            else
-                            {
-                                std::cerr << "recv error\n";
-                                running_.store(false, std::memory_order_release);
-                                break;
-                            }
-                        }
-                        else if (count == 0)
-                        {
-                            // Connection closed
-                            std::cerr << "Server closed connection\n";
-                            running_.store(false, std::memory_order_release);
-                            break;
-                        }
-                        else
-                        {
-                            // Process received data
-                            size_t start = 0;
-                            std::vector<std::shared_ptr<DataRecord>> batch_records;
-                            for (ssize_t j = 0; j < count; ++j)
-                            {
-                                if (buffer_[j] == '\n')
-                                {
-                                    std::string_view msg_view(&buffer_[start], j - start);
-                                    if (msg_view == "STOP")
-                                    {
-                                        std::cout << "Received STOP message. Terminating ingestion.\n";
-                                        running_.store(false, std::memory_order_release);
-                                        break;
-                                    }
-
-                                    auto record = memory_pool_.acquire();
-                                    if (record)
-                                    {
-                                        record->timestamp = static_cast<uint64_t>(
-                                            std::chrono::duration_cast<std::chrono::milliseconds>(
-                                                std::chrono::system_clock::now().time_since_epoch()
-                                            ).count()
-                                        );
-                                        record->message = std::string(msg_view);
-                                        batch_records.push_back(record);
-                                    }
-                                    start = j + 1;
-                                }
-                            }
-
-                            // Enqueue all records in the batch
-                            for (auto& rec : batch_records)
-                            {
-                                data_queue_.enqueue(rec);
-                            }
-
-                            // Check if running flag was set to false by STOP message
-                            if (!running_.load(std::memory_order_acquire))
-                            {
-                                break;
-                            }
-                        }
-                    }
-                }
+                // Finalize the non-blocking connect
+                complete_connect(state, conn, now);
+            }
+            else if (conn.state == FeedConnection::State::Connected &&
+                     (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+            {
+                // Edge-triggered: remember the socket is readable until recv hits EAGAIN
+                conn.readable = true;
             }
         }
-    }
-
-    std::cout << "Data Ingestion Module Stopped.\n";
 
-    // Cleanup
-    close(sock_fd_);
-    sock_fd_ = -1;
-    close(epoll_fd_);
-    epoll_fd_ = -1;
+        for (size_t i = 0; i < state.connections.size(); ++i)
+        {
+            FeedConnection& conn = *state.connections[i];
+            if (!conn.readable || conn.state != FeedConnection::State::Connected)
+            {
+                continue;
+            }
+            if (conn.kind == FeedConnection::Kind::Listener)
+            {
+                accept_connections(state, conn);
+            }
+            else if (conn.transport == Transport::Udp)
+            {
+                drain_datagrams(state, conn, now);
+            }
+            else
+            {
+                drain_socket(state, conn, buffer.data(), now);
+            }
+        }
+
+        // Forget producers that have gone away
+        state.connections.erase(
+            std::remove_if(state.connections.begin(), state.connections.end(),
+                           [](const std::unique_ptr<FeedConnection>& conn)
+                           {
+                               return conn->kind == FeedConnection::Kind::Inbound &&
+                                      conn->state == FeedConnection::State::Finished;
+                           }),
+            state.connections.end());
+    }
+
+    std::cout << "Data Ingestion Module Stopped.\n";
+
+    // Cleanup
+    for (auto& conn : state.connections)
+    {
+        if (conn->fd != -1)
+        {
+            close(conn->fd);
+            conn->fd = -1;
+        }
+    }
+    if (state.epoll_fd != -1)
+    {
+        close(state.epoll_fd);
+    }
+    if (state.capture)
+    {
+        state.capture->close();
+        std::cout << "Captured " << state.capture->chunks() << " chunks (" << state.capture->bytes() << " bytes) to "
+                  << state.capture->path() << "\n";
+    }
+    if (active_threads_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        if (shm_)
+        {
+            // Consumer processes drain what is left and detach
+            shm_->mark_closed();
+        }
+        running_.store(false, std::memory_order_release);
+
+        // Parked consumers drain the rest and then see an empty batch
+        input_finished_.store(true, std::memory_order_release);
+        wake_consumers();
+    }
+}
+
+void DataIngestion::open_listener(IngestThreadState& state, int cpu_core)
+{
+    const ListenConfig& listen_config = config_.listen;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(listen_config.port);
+    if (inet_pton(AF_INET, listen_config.host.c_str(), &addr.sin_addr) <= 0)
+    {
+        std::cerr << "Invalid listen address " << listen_config.host << "\n";
+        return;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        std::cerr << "Listener socket creation failed: " << strerror(errno) << "\n";
+        return;
+    }
+
+    // Every ingestion thread binds the same port; the kernel hashes new connections across them
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        std::cerr << "Failed to set SO_REUSEADDR/SO_REUSEPORT: " << strerror(errno) << "\n";
+        close(fd);
+        return;
+    }
+#ifdef SO_INCOMING_CPU
+    if (listen_config.incoming_cpu &&
+        setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu_core, sizeof(cpu_core)) < 0)
+    {
+        std::cerr << "Failed to set SO_INCOMING_CPU: " << strerror(errno) << "\n";
+    }
+#else
+    (void)cpu_core;
+#endif
+
+    // Accepted sockets inherit the receive buffer size
+    int recv_buffer_size = state.socket_rcvbuf;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &recv_buffer_size, sizeof(recv_buffer_size)) < 0)
+    {
+        std::cerr << "Failed to set SO_RCVBUF\n";
+    }
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, listen_config.backlog) < 0)
+    {
+        std::cerr << "Failed to listen on " << listen_config.host << ":" << listen_config.port << ": "
+                  << strerror(errno) << "\n";
+        close(fd);
+        return;
+    }
+
+    std::unique_ptr<FeedConnection> listener(new FeedConnection());
+    listener->kind = FeedConnection::Kind::Listener;
+    listener->feed_id = static_cast<uint32_t>(config_.endpoints.size());
+    listener->counters = listener_counters_[state.thread_index].get();
+    listener->fd = fd;
+    listener->state = FeedConnection::State::Connected;
+    listener->readable = true; // Producers may already be queued in the backlog
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = listener.get();
+    if (epoll_ctl(state.epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+    {
+        std::cerr << "epoll_ctl failed: " << strerror(errno) << "\n";
+        close(fd);
+        return;
+    }
+    std::cout << "Listening for producers on " << listen_config.host << ":" << listen_config.port << "\n";
+    state.connections.push_back(std::move(listener));
+}
+
+void DataIngestion::accept_connections(IngestThreadState& state, FeedConnection& listener)
+{
+    for (int accepts = 0; accepts < MAX_ACCEPTS_PER_PASS; ++accepts)
+    {
+        int fd = accept4(listener.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                listener.readable = false;
+                return;
+            }
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+            {
+                continue;
+            }
+            // Out of descriptors or similar: keep the backlog and retry on the next pass
+            std::cerr << "accept failed: " << strerror(errno) << "\n";
+            return;
+        }
+
+        std::unique_ptr<FeedConnection> conn(new FeedConnection());
+        conn->kind = FeedConnection::Kind::Inbound;
+        conn->feed_id = listener.feed_id;
+        conn->counters = listener.counters;
+        conn->fd = fd;
+        conn->state = FeedConnection::State::Connected;
+        conn->readable = true;
+        conn->decoder = FrameDecoder(config_.listen.decoder, config_.max_frame_size);
+
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = conn.get();
+        if (epoll_ctl(state.epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+        {
+            std::cerr << "epoll_ctl failed: " << strerror(errno) << "\n";
+            close(fd);
+            continue;
+        }
+        bump(conn->counters->connects);
+        state.connections.push_back(std::move(conn));
+    }
+}
+
+void DataIngestion::open_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    const EndpointAddress& address = conn.addresses[conn.address_index];
+    conn.counters->address_index.store(conn.address_index, std::memory_order_relaxed);
+    if (conn.transport == Transport::Udp)
+    {
+        open_datagram(state, conn, now_ms);
+        return;
+    }
+
+    // Prepare server address
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(address.port);
+    if (inet_pton(AF_INET, address.host.c_str(), &serv_addr.sin_addr) <= 0)
+    {
+        std::cerr << "Feed " << conn.feed_id << ": invalid address " << format_address(address) << "\n";
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+
+    // Create a non-blocking socket
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn.fd < 0)
+    {
+        std::cerr << "Socket creation failed: " << strerror(errno) << "\n";
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+
+    // Increase socket receive buffer size
+    int recv_buffer_size = state.socket_rcvbuf;
+    if (setsockopt(conn.fd, SOL_SOCKET, SO_RCVBUF, &recv_buffer_size, sizeof(recv_buffer_size)) < 0)
+    {
+        std::cerr << "Failed to set SO_RCVBUF\n";
+    }
+
+    // Register for both directions once: EPOLLOUT reports connect completion,
+    // EPOLLIN and EPOLLRDHUP report data and peer shutdown
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = &conn;
+    if (epoll_ctl(state.epoll_fd, EPOLL_CTL_ADD, conn.fd, &event) == -1)
+    {
+        std::cerr << "epoll_ctl failed: " << strerror(errno) << "\n";
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+
+    // Connect to server
+    int res = connect(conn.fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+    if (res == 0)
+    {
+        mark_connected(conn);
+    }
+    else if (errno == EINPROGRESS)
+    {
+        conn.state = FeedConnection::State::Connecting;
+        conn.deadline_ms = now_ms + static_cast<uint64_t>(state.reconnect.connect_timeout_ms);
+        conn.counters->state.store(static_cast<int>(conn.state), std::memory_order_relaxed);
+    }
+    else
+    {
+        if (conn.consecutive_failures == 0)
+        {
+            std::cerr << "Feed " << conn.feed_id << ": connection to " << format_address(address)
+                      << " failed: " << strerror(errno) << "\n";
+        }
+        fail_connection(state, conn, now_ms);
+    }
+}
+
+void DataIngestion::open_datagram(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    const EndpointAddress& address = conn.addresses[conn.address_index];
+    conn.fd = open_datagram_socket(address.host, address.port, config_.udp.interface, state.socket_rcvbuf,
+                                   SOCK_NONBLOCK, "Feed " + std::to_string(conn.feed_id));
+    if (conn.fd < 0)
+    {
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+    conn.socket_drops = 0;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = &conn;
+    if (epoll_ctl(state.epoll_fd, EPOLL_CTL_ADD, conn.fd, &event) == -1)
+    {
+        std::cerr << "epoll_ctl failed: " << strerror(errno) << "\n";
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+
+    state.datagrams.prepare(config_.udp, arena_);
+    mark_connected(conn);
+}
+
+void DataIngestion::complete_connect(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+    {
+        err = errno;
+    }
+    if (err != 0)
+    {
+        if (conn.consecutive_failures == 0)
+        {
+            std::cerr << "Feed " << conn.feed_id << ": connect to "
+                      << format_address(conn.addresses[conn.address_index]) << " failed: " << strerror(err) << "\n";
+        }
+        fail_connection(state, conn, now_ms);
+        return;
+    }
+    mark_connected(conn);
+}
+
+void DataIngestion::mark_connected(FeedConnection& conn)
+{
+    std::cout << "Feed " << conn.feed_id << (conn.transport == Transport::Udp ? ": receiving on " : ": connected to ")
+              << format_address(conn.addresses[conn.address_index]) << "\n";
+    conn.state = FeedConnection::State::Connected;
+    conn.capture_stream = 0; // A reconnect starts a new capture stream
+    conn.consecutive_failures = 0;
+    conn.backoff_ms = 0;
+    conn.readable = true; // Data may have arrived together with the connect completion
+    FeedCounters& counters = *conn.counters;
+    bump(counters.connects);
+    counters.state.store(static_cast<int>(conn.state), std::memory_order_relaxed);
+}
+
+void DataIngestion::fail_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    if (conn.fd != -1)
+    {
+        close(conn.fd);
+        conn.fd = -1;
+    }
+    FeedCounters& counters = *conn.counters;
+    bump(counters.connect_failures);
+
+    // Move to the next address after repeated failures and try it right away
+    if (++conn.consecutive_failures >= state.reconnect.failover_after && conn.addresses.size() > 1)
+    {
+        size_t previous = conn.address_index;
+        conn.address_index = (conn.address_index + 1) % conn.addresses.size();
+        conn.consecutive_failures = 0;
+        conn.backoff_ms = 0;
+        bump(counters.failovers);
+        std::cerr << "Feed " << conn.feed_id << ": failing over from " << format_address(conn.addresses[previous])
+                  << " to " << format_address(conn.addresses[conn.address_index]) << "\n";
+    }
+    schedule_reconnect(state, conn, now_ms);
+}
+
+void DataIngestion::drop_connection(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    if (conn.kind == FeedConnection::Kind::Inbound)
+    {
+        // Producers reconnect on their own; the event loop erases the entry
+        finish_connection(conn);
+        return;
+    }
+
+    close(conn.fd);
+    conn.fd = -1;
+    conn.readable = false;
+    conn.decoder.reset(); // A partial frame cannot be resumed on a new connection
+    bump(conn.counters->disconnects);
+
+    // Prefer the primary again after losing an established connection
+    conn.address_index = 0;
+    conn.backoff_ms = 0;
+    schedule_reconnect(state, conn, now_ms);
+}
+
+void DataIngestion::schedule_reconnect(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    if (!state.reconnect.enabled)
+    {
+        finish_connection(conn);
+        return;
+    }
+    const uint64_t initial = static_cast<uint64_t>(state.reconnect.initial_ms);
+    const uint64_t max_delay = static_cast<uint64_t>(std::max(state.reconnect.max_ms, state.reconnect.initial_ms));
+    conn.backoff_ms = conn.backoff_ms == 0 ? initial : std::min(conn.backoff_ms * 2, max_delay);
+
+    // Jitter into [backoff/2, backoff] to spread out feeds that failed together
+    uint64_t half = conn.backoff_ms / 2;
+    conn.deadline_ms = now_ms + half + next_random(state.rng) % (conn.backoff_ms - half + 1);
+    conn.state = FeedConnection::State::Backoff;
+    conn.counters->state.store(static_cast<int>(conn.state), std::memory_order_relaxed);
+}
+
+void DataIngestion::finish_connection(FeedConnection& conn)
+{
+    if (conn.fd != -1)
+    {
+        close(conn.fd);
+        conn.fd = -1;
+    }
+    conn.readable = false;
+    conn.state = FeedConnection::State::Finished;
+    if (conn.kind == FeedConnection::Kind::Inbound)
+    {
+        bump(conn.counters->disconnects);
+        return;
+    }
+    conn.counters->state.store(static_cast<int>(conn.state), std::memory_order_relaxed);
+}
+
+bool DataIngestion::pause_for_overload(IngestThreadState& state)
+{
+    update_overload(state);
+    if (state.flow.policy == OverloadPolicy::PauseRead && state.overloaded)
+    {
+        if (!state.paused)
+        {
+            state.paused = true;
+            pauses_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    state.paused = false;
+    return false;
+}
+
+void DataIngestion::drain_socket(IngestThreadState& state, FeedConnection& conn, char* buffer, uint64_t now_ms)
+{
+    // std::cout << "EPOLLIN event received\n"; // Optional: comment out to reduce verbosity
+    FeedCounters& counters = *conn.counters;
+    std::vector<std::shared_ptr<DataRecord>> batch_records;
+    for (int reads = 0; reads < MAX_READS_PER_PASS; ++reads)
+    {
+        if (pause_for_overload(state))
+        {
+            // Leave data in the kernel buffer; the shrinking TCP window throttles the sender
+            return;
+        }
+
+        ssize_t count = recv(conn.fd, buffer, config_.buffer_size, 0);
+        if (count == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // All data read
+                conn.readable = false;
+                return;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Feed " << conn.feed_id << ": recv error: " << strerror(errno) << "\n";
+            drop_connection(state, conn, now_ms);
+            return;
+        }
+        else if (count == 0)
+        {
+            // Connection closed
+            if (conn.kind == FeedConnection::Kind::Outbound)
+            {
+                std::cerr << "Feed " << conn.feed_id << ": server closed connection\n";
+            }
+            drop_connection(state, conn, now_ms);
+            return;
+        }
+        bump(counters.bytes_received, static_cast<uint64_t>(count));
+        if (state.capture)
+        {
+            capture(state, conn, SystemClockNs::now(), buffer, static_cast<size_t>(count));
+        }
+
+        // Process received data
+        uint64_t timestamp = SystemClockMs::now();
+        batch_records.clear();
+        bool stop_received = false;
+        uint64_t frames = 0;
+        uint64_t filtered = 0;
+        bool framed = conn.decoder.feed(buffer, static_cast<size_t>(count),
+            [this, &state, &conn, timestamp, &batch_records, &stop_received, &frames, &filtered](std::string_view msg_view)
+            {
+                if (StopMessage::matches(msg_view))
+                {
+                    if (conn.kind == FeedConnection::Kind::Outbound)
+                    {
+                        std::cout << "Feed " << conn.feed_id << ": received STOP message. Terminating ingestion.\n";
+                    }
+                    stop_received = true;
+                    return false;
+                }
+                ++frames;
+                if (!filter_.accept(msg_view))
+                {
+                    ++filtered; // Rejected in the receive buffer, before any pool or queue work
+                    return true;
+                }
+                admit(state, timestamp, conn.feed_id, msg_view, batch_records);
+                return true;
+            });
+        bump(counters.records, frames);
+        if (filtered > 0)
+        {
+            bump(counters.filtered, filtered);
+        }
+
+        // Enqueue all records in the batch; shared-memory records become visible together
+        for (auto& rec : batch_records)
+        {
+            publish(state.thread_index, std::move(rec));
+        }
+        if (state.shm)
+        {
+            state.shm->commit();
+        }
+        notify_consumers();
+
+        if (stop_received)
+        {
+            finish_connection(conn);
+            return;
+        }
+        if (!framed)
+        {
+            std::cerr << "Feed " << conn.feed_id << ": frame exceeds max_frame_size; dropping connection\n";
+            drop_connection(state, conn, now_ms);
+            return;
+        }
+        if (!running_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+    }
+}
+
+void DataIngestion::capture(IngestThreadState& state, FeedConnection& conn, uint64_t timestamp_ns, const char* data,
+                            size_t size)
+{
+    if (conn.capture_stream == 0)
+    {
+        conn.capture_stream = state.capture->next_stream();
+    }
+    state.capture->append(timestamp_ns, conn.feed_id, conn.capture_stream, conn.decoder.type(), data, size);
+}
+
+void DataIngestion::drain_datagrams(IngestThreadState& state, FeedConnection& conn, uint64_t now_ms)
+{
+    FeedCounters& counters = *conn.counters;
+    DatagramBatch& batch = state.datagrams;
+    std::vector<std::shared_ptr<DataRecord>> batch_records;
+    for (int reads = 0; reads < MAX_READS_PER_PASS; ++reads)
+    {
+        if (pause_for_overload(state))
+        {
+            // UDP has no back-pressure: datagrams pile up in the socket queue and,
+            // once it is full, show up in kernel_drops
+            return;
+        }
+
+        batch.rearm();
+        int received = recvmmsg(conn.fd, batch.headers.data(), static_cast<unsigned int>(batch.headers.size()), 0, nullptr);
+        if (received == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                conn.readable = false;
+                return;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Feed " << conn.feed_id << ": recvmmsg error: " << strerror(errno) << "\n";
+            drop_connection(state, conn, now_ms);
+            return;
+        }
+
+        // One timestamp per batch, as for a stream recv
+        uint64_t timestamp = SystemClockMs::now();
+        if (state.capture)
+        {
+            const uint64_t received_ns = SystemClockNs::now();
+            for (int i = 0; i < received; ++i)
+            {
+                capture(state, conn, received_ns, static_cast<const char*>(batch.headers[i].msg_hdr.msg_iov->iov_base),
+                        batch.headers[i].msg_len);
+            }
+        }
+        batch_records.clear();
+        bool stop_received = false;
+        uint64_t frames = 0;
+        uint64_t filtered = 0;
+        uint64_t bytes = 0;
+        uint64_t bad = 0;
+        for (int i = 0; i < received && !stop_received; ++i)
+        {
+            struct msghdr& header = batch.headers[i].msg_hdr;
+            bytes += batch.headers[i].msg_len;
+
+            uint32_t drops = DatagramBatch::take_drops(header, conn.socket_drops);
+            if (drops > 0)
+            {
+                bump(counters.kernel_drops, drops);
+            }
+
+            if (header.msg_flags & MSG_TRUNC)
+            {
+                ++bad; // Larger than udp.max_datagram; the tail is gone
+                continue;
+            }
+            bool decoded = conn.decoder.feed_datagram(static_cast<const char*>(header.msg_iov->iov_base),
+                                                      batch.headers[i].msg_len,
+                [this, &state, &conn, timestamp, &batch_records, &stop_received, &frames, &filtered](std::string_view msg_view)
+                {
+                    if (StopMessage::matches(msg_view))
+                    {
+                        std::cout << "Feed " << conn.feed_id << ": received STOP message. Terminating ingestion.\n";
+                        stop_received = true;
+                        return false;
+                    }
+                    ++frames;
+                    if (!filter_.accept(msg_view))
+                    {
+                        ++filtered;
+                        return true;
+                    }
+                    admit(state, timestamp, conn.feed_id, msg_view, batch_records);
+                    return true;
+                });
+            if (!decoded)
+            {
+                ++bad;
+            }
+        }
+        bump(counters.bytes_received, bytes);
+        bump(counters.datagrams, static_cast<uint64_t>(received));
+        bump(counters.records, frames);
+        if (filtered > 0)
+        {
+            bump(counters.filtered, filtered);
+        }
+        if (bad > 0)
+        {
+            bump(counters.bad_datagrams, bad);
+        }
+
+        for (auto& rec : batch_records)
+        {
+            publish(state.thread_index, std::move(rec));
+        }
+        if (state.shm)
+        {
+            state.shm->commit();
+        }
+        notify_consumers();
+
+        if (stop_received)
+        {
+            finish_connection(conn);
+            return;
+        }
+        if (static_cast<size_t>(received) < batch.headers.size())
+        {
+            // Socket queue drained; the next datagram raises a new edge
+            conn.readable = false;
+            return;
+        }
+        if (!running_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+    }
+}
+
+void DataIngestion::admit(IngestThreadState& state, uint64_t timestamp, uint32_t feed_id, std::string_view message,
+                          std::vector<std::shared_ptr<DataRecord>>& batch)
+{
+    // History keeps what the feed sent, even if flow control drops it below
+    if (config_.history.bytes_per_feed > 0)
+    {
+        HistoryBuffer& history = feed_id < feed_history_.size() ? *feed_history_[feed_id]
+                                                                : *listener_history_[state.thread_index];
+        history.append(timestamp, feed_id, message);
+    }
+
+    // Once anything is spilled, later records follow it to disk until it drains
+    if (state.spill && ((state.overloaded && state.flow.policy == OverloadPolicy::SpillToDisk) ||
+                        !state.spill->empty()))
+    {
+        if (state.spill->append(timestamp, feed_id, message))
+        {
+            spilled_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (state.overloaded)
+    {
+        // Shard lanes and shared-memory rings are consumer-owned at the head, so drop-oldest
+        // degrades to drop-newest there
+        if (state.flow.policy == OverloadPolicy::DropNewest ||
+            state.flow.policy == OverloadPolicy::SpillToDisk ||
+            (state.flow.policy == OverloadPolicy::DropOldest && (config_.sharding.num_shards > 0 || state.shm)))
+        {
+            dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (state.flow.policy == OverloadPolicy::DropOldest)
+        {
+            std::shared_ptr<DataRecord> oldest;
+            if (data_queue_.dequeue(oldest))
+            {
+                memory_pool_.release(std::move(oldest));
+                dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (state.shm)
+    {
+        // Straight from the receive buffer into the ring, staged until the batch commits
+        if (!state.shm->append(timestamp, feed_id, message))
+        {
+            dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    auto record = memory_pool_.acquire();
+    if (!record)
+    {
+        // Pool capped at pool_max_size
+        dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    record->timestamp = timestamp;
+    record->feed_id = feed_id;
+    record->message.assign(message.data(), message.size());
+    batch.push_back(std::move(record));
+}
+
+void DataIngestion::unspill(IngestThreadState& state)
+{
+    uint64_t timestamp = 0;
+    uint32_t feed_id = 0;
+    if (state.shm)
+    {
+        std::string message;
+        while (!state.spill->empty() && running_.load(std::memory_order_acquire))
+        {
+            if (!state.spill->read_next(timestamp, feed_id, message))
+            {
+                return;
+            }
+            if (!state.shm->append(timestamp, feed_id, message))
+            {
+                dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+            }
+            state.shm->commit();
+            unspilled_.fetch_add(1, std::memory_order_relaxed);
+
+            update_overload(state);
+            if (state.overloaded)
+            {
+                return;
+            }
+        }
+        return;
+    }
+
+    while (!state.spill->empty() && running_.load(std::memory_order_acquire))
+    {
+        auto record = memory_pool_.acquire();
+        if (!record)
+        {
+            return;
+        }
+        if (!state.spill->read_next(timestamp, feed_id, record->message))
+        {
+            memory_pool_.release(std::move(record));
+            return;
+        }
+        record->timestamp = timestamp;
+        record->feed_id = feed_id;
+        publish(state.thread_index, std::move(record));
+        unspilled_.fetch_add(1, std::memory_order_relaxed);
+        notify_consumers();
+
+        update_overload(state);
+        if (state.overloaded)
+        {
+            return;
+        }
+    }
+}
+
+void DataIngestion::update_overload(IngestThreadState& state)
+{
+    const bool queue_gauge = state.flow.queue_high_watermark > 0;
+    const bool pool_gauge = state.flow.pool_high_watermark > 0;
+    if (!queue_gauge && !pool_gauge)
+    {
+        // Both gauges off (possibly by a reload() mid-overload): resume reading and stop
+        // dropping or spilling
+        state.overloaded = false;
+        state.paused = false;
+        return;
+    }
+
+    size_t depth = queue_gauge ? queue_depth() : 0;
+    size_t in_use = pool_gauge ? memory_pool_.in_use() : 0;
+    if (!state.overloaded)
+    {
+        state.overloaded = (queue_gauge && depth >= state.flow.queue_high_watermark) ||
+                           (pool_gauge && in_use >= state.flow.pool_high_watermark);
+    }
+    else
+    {
+        state.overloaded = !((!queue_gauge || depth <= state.flow.queue_low_watermark) &&
+                             (!pool_gauge || in_use <= state.flow.pool_low_watermark));
+    }
+}
+
+size_t DataIngestion::queue_depth() const
+{
+    size_t depth = data_queue_.size();
+    if (shm_)
+    {
+        // Records the slowest consumer process has yet to read
+        for (size_t ring = 0; ring < config_.ingestion_cores.size(); ++ring)
+        {
+            depth += ShmRingWriter::backlog(*shm_, ring);
+        }
+    }
+    for (const auto& lanes : shard_lanes_)
+    {
+        for (const auto& lane : lanes)
+        {
+            depth += lane->queue.size();
+        }
+    }
+    return depth;
 }
@@ -0,0 +1,120 @@
+// src/datagram_socket.cpp
+
+#include "ingestion/datagram_socket.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+int open_datagram_socket(const std::string& host, int port, const std::string& interface, int socket_rcvbuf,
+                         int type_flags, const std::string& label)
+{
+    struct sockaddr_in local_addr;
+    memset(&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &local_addr.sin_addr) <= 0)
+    {
+        std::cerr << label << ": invalid address " << host << ":" << port << "\n";
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | type_flags, 0);
+    if (fd < 0)
+    {
+        std::cerr << "Socket creation failed: " << strerror(errno) << "\n";
+        return -1;
+    }
+
+    // Several receivers (threads or processes) may subscribe to the same group and port
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+    // Bursts must fit in the socket queue or they are lost; SO_RCVBUFFORCE lifts the
+    // net.core.rmem_max cap when the process has CAP_NET_ADMIN
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &socket_rcvbuf, sizeof(socket_rcvbuf)) < 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &socket_rcvbuf, sizeof(socket_rcvbuf)) < 0)
+    {
+        std::cerr << "Failed to set SO_RCVBUF\n";
+    }
+
+    // Have the kernel report its running count of datagrams dropped on this socket
+    if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &opt, sizeof(opt)) < 0)
+    {
+        std::cerr << "Failed to set SO_RXQ_OVFL: " << strerror(errno) << "\n";
+    }
+
+    // Binding to the group address keeps other groups on the same port out of this socket
+    if (bind(fd, (struct sockaddr*)&local_addr, sizeof(local_addr)) < 0)
+    {
+        std::cerr << label << ": bind to " << host << ":" << port << " failed: " << strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+
+    if (IN_MULTICAST(ntohl(local_addr.sin_addr.s_addr)))
+    {
+        struct ip_mreq membership;
+        memset(&membership, 0, sizeof(membership));
+        membership.imr_multiaddr = local_addr.sin_addr;
+        if (inet_pton(AF_INET, interface.c_str(), &membership.imr_interface) <= 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+        {
+            std::cerr << label << ": joining " << host << " on " << interface << " failed: " << strerror(errno) << "\n";
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+void DatagramBatch::prepare(const UdpConfig& udp, const std::shared_ptr<Arena>& arena)
+{
+    if (!headers.empty())
+    {
+        return;
+    }
+    max_datagram = udp.max_datagram;
+    data = std::vector<char, ArenaAllocator<char>>(udp.batch * max_datagram, ArenaAllocator<char>(arena));
+    control.resize(udp.batch * CONTROL_SIZE);
+    iov.resize(udp.batch);
+    headers.resize(udp.batch);
+    for (size_t i = 0; i < udp.batch; ++i)
+    {
+        iov[i].iov_base = data.data() + i * max_datagram;
+        iov[i].iov_len = max_datagram;
+    }
+}
+
+void DatagramBatch::rearm()
+{
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].msg_hdr.msg_iov = &iov[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_control = control.data() + i * CONTROL_SIZE;
+        headers[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+    }
+}
+
+uint32_t DatagramBatch::take_drops(const struct msghdr& header, uint32_t& last_count)
+{
+    uint32_t dropped = 0;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&header), cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            uint32_t count;
+            memcpy(&count, CMSG_DATA(cmsg), sizeof(count));
+            dropped += count - last_count;
+            last_count = count;
+        }
+    }
+    return dropped;
+}
@@ -0,0 +1,181 @@
+// src/history.cpp
+
+#include "ingestion/history.hpp"
+#include "ingestion/data_ingestion.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+HistoryBuffer::HistoryBuffer(size_t capacity_bytes, Arena* arena)
+    : capacity_(std::max(capacity_bytes, INDEX_STRIDE) & ~(ALIGNMENT - 1)),
+      arena_(arena),
+      ring_(arena_new_array<uint64_t>(arena, capacity_ / sizeof(uint64_t))),
+      index_size_(capacity_ / INDEX_STRIDE + 2),
+      index_(new std::atomic<uint64_t>[index_size_])
+{
+    // At most one indexed record starts per INDEX_STRIDE block, so the index always
+    // covers everything the ring still holds
+    for (size_t i = 0; i < index_size_; ++i)
+    {
+        index_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+HistoryBuffer::~HistoryBuffer()
+{
+    arena_delete_array(arena_, ring_, capacity_ / sizeof(uint64_t));
+}
+
+void HistoryBuffer::evict_until(uint64_t end)
+{
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (end - tail <= capacity_)
+    {
+        return;
+    }
+    const char* ring = reinterpret_cast<const char*>(ring_);
+    while (end - tail > capacity_)
+    {
+        size_t offset = static_cast<size_t>(tail % capacity_);
+        Header header;
+        memcpy(&header, ring + offset, sizeof(header));
+        tail += header.length == WRAP_MARKER ? capacity_ - offset : record_size(header.length);
+    }
+    // Published before the bytes are overwritten; pairs with the fence in read_header()
+    tail_.store(tail, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void HistoryBuffer::append(uint64_t timestamp, uint32_t feed_id, std::string_view message)
+{
+    const size_t size = record_size(message.size());
+    if (size > capacity_ || message.size() >= WRAP_MARKER)
+    {
+        skipped_.store(skipped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    char* ring = reinterpret_cast<char*>(ring_);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    size_t offset = static_cast<size_t>(head % capacity_);
+    if (offset + size > capacity_)
+    {
+        // Records never straddle the end of the ring
+        evict_until(head + (capacity_ - offset) + size);
+        Header marker{0, 0, WRAP_MARKER};
+        memcpy(ring + offset, &marker, sizeof(marker));
+        head += capacity_ - offset;
+        offset = 0;
+    }
+    else
+    {
+        evict_until(head + size);
+    }
+
+    Header header{timestamp, feed_id, static_cast<uint32_t>(message.size())};
+    memcpy(ring + offset, &header, sizeof(header));
+    memcpy(ring + offset + sizeof(header), message.data(), message.size());
+
+    if (head >= next_index_block_)
+    {
+        uint64_t entry = index_count_.load(std::memory_order_relaxed);
+        index_[entry % index_size_].store(head, std::memory_order_relaxed);
+        index_count_.store(entry + 1, std::memory_order_release);
+        next_index_block_ = (head / INDEX_STRIDE + 1) * INDEX_STRIDE;
+    }
+
+    head_.store(head + size, std::memory_order_release);
+    appended_.store(appended_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+bool HistoryBuffer::read_header(uint64_t pos, Header& header) const
+{
+    memcpy(&header, reinterpret_cast<const char*>(ring_) + pos % capacity_, sizeof(header));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return pos >= tail_.load(std::memory_order_relaxed);
+}
+
+uint64_t HistoryBuffer::seek(uint64_t from_ms, uint64_t tail) const
+{
+    // Index entries hold increasing positions; find the first whose record is at or
+    // after from_ms and start from the entry before it. Entries whose record has been
+    // evicted count as older than anything asked for.
+    const uint64_t count = index_count_.load(std::memory_order_acquire);
+    const uint64_t first = count > index_size_ ? count - index_size_ : 0;
+    auto before = [this, from_ms](uint64_t entry)
+    {
+        Header header;
+        return !read_header(index_[entry % index_size_].load(std::memory_order_relaxed), header) ||
+               header.timestamp < from_ms;
+    };
+    uint64_t low = first;
+    uint64_t high = count;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if (before(mid))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if (low == first)
+    {
+        return tail;
+    }
+    uint64_t pos = index_[(low - 1) % index_size_].load(std::memory_order_relaxed);
+    return pos > tail ? pos : tail;
+}
+
+size_t HistoryBuffer::range(uint64_t from_ms, uint64_t to_ms, std::vector<DataRecord>& out, size_t max_records) const
+{
+    const char* ring = reinterpret_cast<const char*>(ring_);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t pos = seek(from_ms, tail_.load(std::memory_order_acquire));
+    size_t found = 0;
+    std::string message;
+    while (pos < head && found < max_records)
+    {
+        const size_t offset = static_cast<size_t>(pos % capacity_);
+        Header header;
+        memcpy(&header, ring + offset, sizeof(header));
+        const bool wrap = header.length == WRAP_MARKER;
+        // A header torn by the writer may hold any length; only copy what fits
+        const bool fits = !wrap && header.length <= capacity_ - offset - sizeof(header);
+        if (fits && header.timestamp >= from_ms && header.timestamp < to_ms)
+        {
+            message.assign(ring + offset + sizeof(header), header.length);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (pos < tail)
+        {
+            pos = tail; // Evicted while we read it; resume at the oldest record left
+            continue;
+        }
+
+        if (wrap)
+        {
+            pos += capacity_ - offset;
+            continue;
+        }
+        if (header.timestamp >= to_ms)
+        {
+            break;
+        }
+        if (header.timestamp >= from_ms)
+        {
+            DataRecord record;
+            record.timestamp = header.timestamp;
+            record.feed_id = header.feed_id;
+            record.message = message;
+            out.push_back(std::move(record));
+            ++found;
+        }
+        pos += record_size(header.length);
+    }
+    return found;
+}
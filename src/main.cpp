@@ -2,6 +2,8 @@
 
 #include "ingestion/data_ingestion.hpp"
 #include "ingestion/config.hpp"
+#include "ingestion/aggregation.hpp"
+#include "ingestion/timestamper.hpp"
 
 #include <iostream>
 #include <thread>
@@ -9,16 +11,26 @@
 #include <memory>
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <csignal>
 #include <unistd.h> // for sysconf
 
 // Function to simulate a server sending test messages with CPU pinning
-void simulate_server(int port, int num_messages, int interval_us, int cpu_core)
+// mode_args selects how the mock server reaches us, e.g. "--connect=<host>" to dial the
+// ingestion listener or "--udp --connect=<group>" to send datagrams
+void simulate_server(int port, int num_messages, int interval_us, int cpu_core, const std::string& mode_args)
 {
     // Build the command to run the mock server with CPU affinity
     std::string command = "taskset -c " + std::to_string(cpu_core) + " ./mock_server " +
                           std::to_string(port) + " " +
                           std::to_string(num_messages) + " " +
                           std::to_string(interval_us) + " STOP";
+    if (!mode_args.empty())
+    {
+        command += " " + mode_args;
+    }
     int ret = system(command.c_str());
     if (ret != 0)
     {
@@ -26,6 +38,92 @@ void simulate_server(int port, int num_messages, int interval_us, int cpu_core)
     }
 }
 
+// Count and recycle records from one shard, or from the shared queue when shard is SIZE_MAX.
+// With aggregation enabled each consumer folds its batches into its own partial.
+ConsumerTask consume(DataIngestion& ingestion, size_t shard, size_t& consumed, WindowAggregator* aggregator,
+                     size_t partial)
+{
+    while (true)
+    {
+        std::vector<std::shared_ptr<DataRecord>> batch =
+            co_await (shard == SIZE_MAX ? ingestion.next_batch() : ingestion.next_shard_batch(shard));
+        if (batch.empty())
+        {
+            break; // Ingestion finished and everything was consumed
+        }
+        consumed += batch.size();
+        if (aggregator != nullptr)
+        {
+            aggregator->add(partial, batch);
+        }
+        for (auto& record : batch)
+        {
+            ingestion.recycle(std::move(record));
+        }
+    }
+}
+
+// Set by SIGHUP to request a configuration reload
+volatile sig_atomic_t reload_requested = 0;
+
+void handle_sighup(int)
+{
+    reload_requested = 1;
+}
+
+// One line per closed window with its busiest keys
+void print_window(const WindowResult& window)
+{
+    std::vector<const WindowKeyResult*> keys;
+    for (const WindowKeyResult& key : window.keys)
+    {
+        keys.push_back(&key);
+    }
+    size_t shown = std::min<size_t>(keys.size(), 3);
+    std::partial_sort(keys.begin(), keys.begin() + shown, keys.end(),
+                      [](const WindowKeyResult* a, const WindowKeyResult* b)
+                      {
+                          return a->aggregate.count > b->aggregate.count;
+                      });
+    std::cout << "Window [" << window.start_ms << ", " << window.end_ms << "): " << window.records << " records, "
+              << window.keys.size() << " keys";
+    for (size_t i = 0; i < shown; ++i)
+    {
+        const KeyAggregate& aggregate = keys[i]->aggregate;
+        std::cout << "; feed " << keys[i]->feed_id << " '" << keys[i]->key << "' " << aggregate.count;
+        if (aggregate.valued > 0)
+        {
+            std::cout << " sum " << aggregate.sum << " p50 " << aggregate.values.quantile(0.5) << " p99 "
+                      << aggregate.values.quantile(0.99);
+        }
+        if (aggregate.distinct.estimate() > 0)
+        {
+            std::cout << " distinct ~" << aggregate.distinct.estimate();
+        }
+    }
+    std::cout << "\n";
+}
+
+// The positional ingestion core list overrides the configured one; checked against
+// num_cores. Applied at startup and again to every reloaded configuration.
+bool apply_positional_cores(const std::vector<std::string>& positional, int num_cores, IngestionConfig& config)
+{
+    if (positional.size() >= 2 && (!parse_core_list(positional[1], config.ingestion_cores) || config.ingestion_cores.empty()))
+    {
+        std::cerr << "Invalid ingestion_thread_core list: " << positional[1] << "\n";
+        return false;
+    }
+    for (int core : config.ingestion_cores)
+    {
+        if (core >= num_cores)
+        {
+            std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char* argv[])
 {
     // Determine the number of available CPU cores
@@ -36,86 +134,164 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // Configuration: defaults, then --config=<file> or INGESTION_CONFIG, then
+    // INGESTION_* environment variables, then --key=value arguments
+    IngestionConfig config;
+    if (!load_config(argc, argv, config))
+    {
+        std::cerr << "Invalid configuration.\n";
+        return -1;
+    }
+
+    // Positional arguments
+    // Usage: ./data_ingestion [mock_server_core] [ingestion_thread_core1,ingestion_thread_core2,...] [--key=value ...]
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            positional.push_back(argv[i]);
+        }
+    }
+
     // Default CPU cores
     int mock_server_core = 1;
-    std::vector<int> ingestion_thread_cores = {2};
-
-    // Parse command-line arguments
-    // Usage: ./data_ingestion [mock_server_core] [ingestion_thread_core1,ingestion_thread_core2,...]
-    if (argc >= 2)
+    if (positional.size() >= 1)
     {
-        mock_server_core = std::stoi(argv[1]);
+        mock_server_core = std::stoi(positional[0]);
         if (mock_server_core < 0 || mock_server_core >= num_cores)
         {
             std::cerr << "Invalid mock_server_core. Must be between 0 and " << num_cores - 1 << ".\n";
             return -1;
         }
     }
-    if (argc >= 3)
+    if (!apply_positional_cores(positional, num_cores, config))
     {
-        // Assume comma-separated core numbers
-        std::string cores_str = argv[2];
-        ingestion_thread_cores.clear();
-        size_t start = 0;
-        size_t end = cores_str.find(',');
-        while (end != std::string::npos)
-        {
-            int core = std::stoi(cores_str.substr(start, end - start));
-            if (core >= 0 && core < num_cores)
-            {
-                ingestion_thread_cores.push_back(core);
-            }
-            else
-            {
-                std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
-                return -1;
-            }
-            start = end + 1;
-            end = cores_str.find(',', start);
-        }
-        // Last core
-        int core = std::stoi(cores_str.substr(start));
-        if (core >= 0 && core < num_cores)
-        {
-            ingestion_thread_cores.push_back(core);
-        }
-        else
-        {
-            std::cerr << "Invalid ingestion_thread_core: " << core << ". Must be between 0 and " << num_cores - 1 << ".\n";
-            return -1;
-        }
+        return -1;
     }
 
-    // Configuration
-    IngestionConfig config = get_default_config();
+    // Re-read the configuration on SIGHUP and apply its runtime-tunable fields
+    signal(SIGHUP, handle_sighup);
 
     // Test parameters
     int num_messages = 100000; // Adjust as needed for testing
     int interval_us = 10;      // Microseconds between messages
 
-    // Start mock server in a separate thread
-    std::thread server_thread(simulate_server, config.port, num_messages, interval_us, mock_server_core);
+    // The mock server feeds the first endpoint. Without outbound endpoints it acts as a
+    // producer dialing the listener; for a UDP endpoint it sends datagrams to it.
+    bool listening = !config.listen.host.empty();
+    if (config.endpoints.empty() && !listening)
+    {
+        std::cerr << "No endpoints and no listen address configured.\n";
+        return -1;
+    }
+    bool producer_mode = config.endpoints.empty();
+    int server_port = producer_mode ? config.listen.port : config.endpoints.front().port;
+    std::string mode_args;
+    if (producer_mode)
+    {
+        mode_args = "--connect=" + config.listen.host;
+    }
+    else if (config.endpoints.front().transport == Transport::Udp)
+    {
+        mode_args = "--udp --connect=" + config.endpoints.front().host;
+    }
+
+    std::atomic<bool> server_done(false);
+    std::thread server_thread;
+    auto start_server = [&]()
+    {
+        server_thread = std::thread([&, server_port]()
+        {
+            simulate_server(server_port, num_messages, interval_us, mock_server_core, mode_args);
+            server_done.store(true, std::memory_order_release);
+        });
+    };
 
-    // Give the server a moment to start
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // A listening mock server must be up before we connect; a sending one must wait for us
+    if (mode_args.empty())
+    {
+        start_server();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
 
     // Start Data Ingestion
-    DataIngestion ingestion(config.ip, config.port, ingestion_thread_cores);
+    DataIngestion ingestion(config);
     ingestion.start();
+    if (!mode_args.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        start_server();
+    }
+
+    // Consumers are coroutines on a small executor pinned to consumer_cores; they park
+    // in next_batch() while there is nothing to read. Sharded mode gets one per shard.
+    ConsumerExecutor executor(config.consumer_cores);
+    size_t num_consumers = ingestion.num_shards() > 0 ? ingestion.num_shards() : 1;
+    std::unique_ptr<WindowAggregator> aggregator;
+    if (config.aggregation.window_ms > 0)
+    {
+        aggregator.reset(new WindowAggregator(config.aggregation, num_consumers, print_window));
+    }
+    std::vector<size_t> consumed(num_consumers, 0);
+    for (size_t i = 0; i < num_consumers; ++i)
+    {
+        size_t shard = ingestion.num_shards() > 0 ? i : SIZE_MAX;
+        executor.spawn(consume(ingestion, shard, consumed[i], aggregator.get(), i), i);
+    }
 
     // Wait for the ingestion module to process all messages
     // This is determined by the "STOP" message from the server
     // Wait until the ingestion module stops running
-    std::shared_ptr<DataRecord> record;
-    while (ingestion.get_data(record))
+    // A listener never stops by itself; in producer mode stop once the producer has
+    // exited and every connection it made has been drained and closed.
+    auto producers_finished = [&]()
+    {
+        if (!producer_mode || !server_done.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        const ConnectionStats listener = ingestion.get_connection_stats().back();
+        return listener.connects > 0 && listener.connects == listener.disconnects;
+    };
+    while (ingestion.is_running() && !producers_finished())
     {
-        // Optionally, process the record
-        // Example:
-        // std::cout << "Timestamp: " << record->timestamp << ", Message: " << record->message << std::endl;
+        if (reload_requested)
+        {
+            reload_requested = 0;
+            IngestionConfig reloaded;
+            if (!load_config(argc, argv, reloaded) || !apply_positional_cores(positional, num_cores, reloaded))
+            {
+                std::cerr << "Invalid configuration; keeping the current one\n";
+            }
+            else if (ingestion.reload(reloaded))
+            {
+                std::cout << "Configuration reloaded\n";
+            }
+            else
+            {
+                // reload() named each structural field it kept
+                std::cout << "Runtime settings reloaded; the structural changes above need a restart\n";
+            }
+        }
+        if (aggregator)
+        {
+            // Windows still close while the feeds are quiet
+            aggregator->advance(SystemClockMs::now());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
-    // Stop ingestion
+    // Stop ingestion; consumers finish once they have drained everything
     ingestion.stop();
+    executor.wait();
+    if (aggregator)
+    {
+        aggregator->flush();
+        AggregationStats stats = aggregator->stats();
+        std::cout << "Aggregated " << stats.records << " records into " << stats.windows << " windows ("
+                  << stats.late << " late, " << stats.unparsed << " without a numeric value)\n";
+    }
 
     // Join server thread
     if (server_thread.joinable())
@@ -123,20 +299,76 @@ int main(int argc, char* argv[])
         server_thread.join();
     }
 
-    // Retrieve ingested data
-    std::vector<std::shared_ptr<DataRecord>> data;
-    while (ingestion.get_data(record))
-    {
-        data.push_back(record);
-    }
-
     // Calculate and display messages per second
     // Since we no longer have fixed timing, we'll need to measure time differently
     // For simplicity, we can assume the server has sent all messages by now
     // Alternatively, integrate timing within the ingestion module
 
     // For now, display the total messages ingested
-    std::cout << "Total Messages Ingested: " << data.size() << std::endl;
+    size_t total_ingested = 0;
+    for (size_t count : consumed)
+    {
+        total_ingested += count;
+    }
+    std::cout << "Total Messages Ingested: " << total_ingested << std::endl;
+    if (config.memory.arena_bytes > 0)
+    {
+        ArenaStats arena = ingestion.get_arena_stats();
+        std::cout << "Arena: " << arena.used / (1024 * 1024) << " of " << arena.reserved / (1024 * 1024) << " MB used on "
+                  << arena_backing_name(arena.backing) << (arena.locked ? ", locked" : "") << ", reserved in "
+                  << arena.reserve_ns / 1000000.0 << " ms, " << arena.heap_fallbacks << " heap fallbacks" << std::endl;
+    }
+    if (!config.shm.name.empty())
+    {
+        // Records went to consumer processes instead of the in-process queues
+        FlowControlStats flow = ingestion.get_flow_control_stats();
+        std::cout << "Published to shared memory " << config.shm.name << " (" << flow.dropped_newest
+                  << " dropped)" << std::endl;
+    }
+
+    for (const ConnectionStats& feed : ingestion.get_connection_stats())
+    {
+        std::cout << "Feed " << feed.feed_id << " (" << feed.address << "): " << feed.records << " records, "
+                  << feed.connects << " connects, " << feed.connect_failures << " failed attempts, "
+                  << feed.disconnects << " disconnects, " << feed.failovers << " failovers";
+        if (feed.filtered > 0)
+        {
+            std::cout << ", " << feed.filtered << " filtered out";
+        }
+        if (feed.datagrams > 0)
+        {
+            std::cout << ", " << feed.datagrams << " datagrams, " << feed.bad_datagrams << " discarded, "
+                      << feed.kernel_drops << " dropped by the kernel";
+        }
+        std::cout << "\n";
+    }
+
+    if (config.history.bytes_per_feed > 0)
+    {
+        // What an operator asking for "the last second of feed X" would get
+        uint64_t now = SystemClockMs::now();
+        for (const ConnectionStats& feed : ingestion.get_connection_stats())
+        {
+            std::vector<DataRecord> recent;
+            ingestion.get_history(static_cast<uint32_t>(feed.feed_id), now - 1000, now + 1, recent);
+            std::cout << "Feed " << feed.feed_id << " history: " << recent.size() << " records in the last second";
+            if (!recent.empty())
+            {
+                std::cout << ", newest '" << recent.back().message << "'";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    if (ingestion.num_shards() > 0)
+    {
+        ShardStats stats = ingestion.get_shard_stats();
+        for (size_t shard = 0; shard < stats.routed.size(); ++shard)
+        {
+            std::cout << "Shard " << shard << ": " << stats.routed[shard] << " records\n";
+        }
+        std::cout << "Shard skew (max/mean): " << stats.skew << std::endl;
+    }
 
     // Optionally, process or analyze the ingested data here
 
@@ -0,0 +1,83 @@
+// src/pipeline.cpp
+
+#include "ingestion/pipeline.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace
+{
+    // Receive timeout, so run() notices stop() on an idle socket
+    const int RECEIVE_TIMEOUT_MS = 100;
+
+    void set_receive_timeout(int fd)
+    {
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = RECEIVE_TIMEOUT_MS * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+}
+
+TcpTransport::TcpTransport(std::string host, int port, size_t buffer_size, int socket_rcvbuf)
+    : host_(std::move(host)), port_(port), socket_rcvbuf_(socket_rcvbuf), buffer_(buffer_size)
+{
+}
+
+TcpTransport::TcpTransport(TcpTransport&& other) noexcept
+    : host_(std::move(other.host_)),
+      port_(other.port_),
+      socket_rcvbuf_(other.socket_rcvbuf_),
+      fd_(other.fd_),
+      buffer_(std::move(other.buffer_))
+{
+    other.fd_ = -1;
+}
+
+TcpTransport::~TcpTransport()
+{
+    close();
+}
+
+bool TcpTransport::open()
+{
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, host_.c_str(), &serv_addr.sin_addr) <= 0)
+    {
+        std::cerr << "Pipeline: invalid address " << host_ << ":" << port_ << "\n";
+        return false;
+    }
+
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        std::cerr << "Socket creation failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    if (setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &socket_rcvbuf_, sizeof(socket_rcvbuf_)) < 0)
+    {
+        std::cerr << "Failed to set SO_RCVBUF\n";
+    }
+    if (connect(fd_, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        std::cerr << "Pipeline: connection to " << host_ << ":" << port_ << " failed: " << strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    set_receive_timeout(fd_);
+    return true;
+}
+
+void TcpTransport::close()
+{
+    if (fd_ != -1)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
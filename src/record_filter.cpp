@@ -0,0 +1,233 @@
+// src/record_filter.cpp
+
+#include "ingestion/record_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INGESTION_HAVE_SSSE3 1
+#endif
+
+void MultiSubstringMatcher::compile(const std::vector<std::string>& patterns)
+{
+    patterns_.clear();
+    for (const std::string& pattern : patterns)
+    {
+        if (!pattern.empty())
+        {
+            patterns_.push_back(pattern);
+        }
+    }
+    // Neighbours in sorted order share leading bytes, so contiguous runs make tight buckets
+    std::sort(patterns_.begin(), patterns_.end());
+    patterns_.erase(std::unique(patterns_.begin(), patterns_.end()), patterns_.end());
+
+    for (auto& bucket : buckets_)
+    {
+        bucket.clear();
+    }
+    memset(low_nibbles_, 0, sizeof(low_nibbles_));
+    memset(high_nibbles_, 0, sizeof(high_nibbles_));
+    search_ = &MultiSubstringMatcher::find_scalar;
+    if (patterns_.empty())
+    {
+        fingerprint_ = 0;
+        min_length_ = 1;
+        return;
+    }
+
+    min_length_ = patterns_.front().size();
+    for (const std::string& pattern : patterns_)
+    {
+        min_length_ = std::min(min_length_, pattern.size());
+    }
+    fingerprint_ = std::min(min_length_, MAX_FINGERPRINT);
+
+    for (size_t i = 0; i < patterns_.size(); ++i)
+    {
+        size_t bucket = i * BUCKETS / patterns_.size();
+        buckets_[bucket].push_back(static_cast<uint16_t>(i));
+        for (size_t j = 0; j < fingerprint_; ++j)
+        {
+            unsigned char byte = static_cast<unsigned char>(patterns_[i][j]);
+            low_nibbles_[j][byte & 0x0f] |= static_cast<uint8_t>(1u << bucket);
+            high_nibbles_[j][byte >> 4] |= static_cast<uint8_t>(1u << bucket);
+        }
+    }
+
+#ifdef INGESTION_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        search_ = &MultiSubstringMatcher::find_ssse3;
+    }
+#endif
+}
+
+const char* MultiSubstringMatcher::engine() const
+{
+    return search_ == &MultiSubstringMatcher::find_ssse3 ? "ssse3" : "scalar";
+}
+
+bool MultiSubstringMatcher::verify(const char* data, size_t size, size_t pos, uint8_t buckets) const
+{
+    while (buckets != 0)
+    {
+        size_t bucket = static_cast<size_t>(__builtin_ctz(buckets));
+        buckets &= static_cast<uint8_t>(buckets - 1);
+        for (uint16_t index : buckets_[bucket])
+        {
+            const std::string& pattern = patterns_[index];
+            if (pos + pattern.size() <= size && memcmp(data + pos, pattern.data(), pattern.size()) == 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool MultiSubstringMatcher::scan_scalar(const char* data, size_t size, size_t from) const
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (size_t pos = from; pos + min_length_ <= size; ++pos)
+    {
+        uint8_t buckets = 0xff;
+        for (size_t j = 0; j < fingerprint_ && buckets != 0; ++j)
+        {
+            unsigned char byte = bytes[pos + j];
+            buckets &= low_nibbles_[j][byte & 0x0f] & high_nibbles_[j][byte >> 4];
+        }
+        if (buckets != 0 && verify(data, size, pos, buckets))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MultiSubstringMatcher::find_scalar(const char* data, size_t size) const
+{
+    return scan_scalar(data, size, 0);
+}
+
+#ifdef INGESTION_HAVE_SSSE3
+__attribute__((target("ssse3")))
+bool MultiSubstringMatcher::find_ssse3(const char* data, size_t size) const
+{
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+    __m128i low[MAX_FINGERPRINT];
+    __m128i high[MAX_FINGERPRINT];
+    for (size_t j = 0; j < fingerprint_; ++j)
+    {
+        low[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(low_nibbles_[j]));
+        high[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(high_nibbles_[j]));
+    }
+
+    // Each block tests start positions pos..pos+15, reading up to fingerprint_ - 1 bytes past them
+    size_t pos = 0;
+    while (pos + 16 + fingerprint_ - 1 <= size)
+    {
+        __m128i candidates = _mm_set1_epi8(-1);
+        for (size_t j = 0; j < fingerprint_; ++j)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + j));
+            __m128i low_bits = _mm_and_si128(bytes, nibble_mask);
+            __m128i high_bits = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+            candidates = _mm_and_si128(candidates, _mm_and_si128(_mm_shuffle_epi8(low[j], low_bits),
+                                                                 _mm_shuffle_epi8(high[j], high_bits)));
+        }
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, _mm_setzero_si128()))) & 0xffffu;
+        if (mask != 0)
+        {
+            alignas(16) uint8_t lanes[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), candidates);
+            while (mask != 0)
+            {
+                size_t lane = static_cast<size_t>(__builtin_ctz(mask));
+                mask &= mask - 1;
+                if (verify(data, size, pos + lane, lanes[lane]))
+                {
+                    return true;
+                }
+            }
+        }
+        pos += 16;
+    }
+    return scan_scalar(data, size, pos);
+}
+#else
+bool MultiSubstringMatcher::find_ssse3(const char* data, size_t size) const
+{
+    return find_scalar(data, size);
+}
+#endif
+
+void RecordFilter::compile(const FilterConfig& config)
+{
+    enabled_ = !config.patterns.empty();
+    keep_matching_ = config.keep_matching;
+    delimiter_ = config.field_delimiter;
+    prefixes_.clear();
+    fields_.clear();
+    std::vector<std::string> substrings;
+    for (const FilterPattern& pattern : config.patterns)
+    {
+        switch (pattern.match)
+        {
+        case FilterMatch::Prefix:
+            prefixes_.push_back(pattern.text);
+            break;
+        case FilterMatch::Field:
+            fields_.emplace_back(pattern.field, pattern.text);
+            break;
+        default:
+            substrings.push_back(pattern.text);
+            break;
+        }
+    }
+    substrings_.compile(substrings);
+}
+
+bool RecordFilter::matches(std::string_view frame) const
+{
+    for (const std::string& prefix : prefixes_)
+    {
+        if (frame.size() >= prefix.size() && memcmp(frame.data(), prefix.data(), prefix.size()) == 0)
+        {
+            return true;
+        }
+    }
+    for (const auto& field : fields_)
+    {
+        // Walk to the field; a frame with fewer fields does not match
+        size_t start = 0;
+        size_t index = 0;
+        while (index < field.first && start <= frame.size())
+        {
+            size_t pos = frame.find(delimiter_, start);
+            if (pos == std::string_view::npos)
+            {
+                start = frame.size() + 1;
+                break;
+            }
+            start = pos + 1;
+            ++index;
+        }
+        if (start > frame.size())
+        {
+            continue;
+        }
+        size_t end = frame.find(delimiter_, start);
+        if (end == std::string_view::npos)
+        {
+            end = frame.size();
+        }
+        if (frame.substr(start, end - start) == field.second)
+        {
+            return true;
+        }
+    }
+    return !substrings_.empty() && substrings_.find(frame.data(), frame.size());
+}
@@ -0,0 +1,409 @@
+// src/shm_ring.cpp
+
+#include "ingestion/shm_ring.hpp"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <iostream>
+#include <new>
+
+namespace
+{
+    const size_t PAGE_SIZE = 4096;
+
+    size_t round_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    size_t next_power_of_two(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Shared (not FUTEX_PRIVATE) operations, since waiters live in other processes
+    long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+    }
+
+    bool process_alive(int32_t pid)
+    {
+        return kill(pid, 0) == 0 || errno != ESRCH;
+    }
+}
+
+ShmSegment::~ShmSegment()
+{
+    close();
+}
+
+size_t ShmSegment::data_offset()
+{
+    return round_up(sizeof(ShmRingHeader), PAGE_SIZE);
+}
+
+size_t ShmSegment::ring_offset(size_t index) const
+{
+    return round_up(sizeof(ShmSegmentHeader), PAGE_SIZE) + index * header_->ring_stride;
+}
+
+bool ShmSegment::create(const std::string& name, size_t ring_count, size_t ring_bytes, size_t max_readers)
+{
+    close();
+    ring_bytes = next_power_of_two(ring_bytes < PAGE_SIZE ? PAGE_SIZE : ring_bytes);
+    const size_t stride = data_offset() + ring_bytes;
+    const size_t size = round_up(sizeof(ShmSegmentHeader), PAGE_SIZE) + ring_count * stride;
+
+    // A previous run may have died without unlinking
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0)
+    {
+        std::cerr << "Failed to size shared memory " << name << ": " << strerror(errno) << "\n";
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "Failed to map shared memory " << name << ": " << strerror(errno) << "\n";
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    name_ = name;
+    owner_ = true;
+    base_ = static_cast<char*>(base);
+    size_ = size;
+
+    // The fresh mapping is zero-filled; construct the atomics in place
+    header_ = new (base_) ShmSegmentHeader();
+    header_->ring_count = static_cast<uint32_t>(ring_count);
+    header_->ring_bytes = ring_bytes;
+    header_->ring_stride = stride;
+    header_->max_readers = static_cast<uint32_t>(max_readers < SHM_MAX_READERS ? max_readers : SHM_MAX_READERS);
+    header_->version = SHM_VERSION;
+    for (size_t i = 0; i < ring_count; ++i)
+    {
+        new (ring(i)) ShmRingHeader();
+    }
+
+    // Readers check the magic last, so everything above is visible once it is set
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_MAGIC;
+    return true;
+}
+
+bool ShmSegment::attach(const std::string& name)
+{
+    close();
+    int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ShmSegmentHeader))
+    {
+        std::cerr << "Shared memory " << name << " is not initialised\n";
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "Failed to map shared memory " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    ShmSegmentHeader* header = static_cast<ShmSegmentHeader*>(base);
+    if (header->magic != SHM_MAGIC || header->version != SHM_VERSION)
+    {
+        std::cerr << "Shared memory " << name << " has an unknown layout\n";
+        munmap(base, size);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    name_ = name;
+    owner_ = false;
+    base_ = static_cast<char*>(base);
+    size_ = size;
+    header_ = header;
+    return true;
+}
+
+void ShmSegment::close()
+{
+    if (base_ == nullptr)
+    {
+        return;
+    }
+    munmap(base_, size_);
+    if (owner_)
+    {
+        shm_unlink(name_.c_str());
+    }
+    base_ = nullptr;
+    header_ = nullptr;
+    size_ = 0;
+    owner_ = false;
+}
+
+void ShmSegment::mark_closed()
+{
+    header_->closed.store(1, std::memory_order_release);
+    header_->futex.fetch_add(1, std::memory_order_seq_cst);
+    futex(&header_->futex, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+void ShmSegment::notify()
+{
+    header_->futex.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->waiters.load(std::memory_order_seq_cst) > 0)
+    {
+        futex(&header_->futex, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+void ShmSegment::wait(uint32_t seen, int timeout_ms)
+{
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+    // Returns at once if a commit already changed the word after seen was read
+    futex(&header_->futex, FUTEX_WAIT, seen, &timeout);
+    header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+ShmRingWriter::ShmRingWriter(ShmSegment& segment, size_t ring_index)
+    : segment_(segment), header_(segment.header()), ring_(segment.ring(ring_index)),
+      data_(segment.ring_data(ring_index)), mask_(segment.header()->ring_bytes - 1)
+{
+    pending_pos_ = ring_->write_pos.load(std::memory_order_relaxed);
+    pending_records_ = ring_->records_written.load(std::memory_order_relaxed);
+    limit_ = slowest_reader(false) + header_->ring_bytes;
+}
+
+uint64_t ShmRingWriter::slowest_reader(bool reclaim_dead) const
+{
+    uint64_t slowest = ring_->write_pos.load(std::memory_order_relaxed);
+    for (size_t slot = 0; slot < header_->max_readers; ++slot)
+    {
+        ShmReaderSlot& reader = header_->readers[slot];
+        if (reader.active.load(std::memory_order_acquire) == 0)
+        {
+            continue;
+        }
+        if (reclaim_dead && !process_alive(reader.pid.load(std::memory_order_relaxed)))
+        {
+            // A consumer that crashed would otherwise stall the ring forever
+            reader.active.store(0, std::memory_order_release);
+            reader.pid.store(0, std::memory_order_release);
+            continue;
+        }
+        uint64_t read_pos = ring_->cursors[slot].read_pos.load(std::memory_order_acquire);
+        if (read_pos < slowest)
+        {
+            slowest = read_pos;
+        }
+    }
+    return slowest;
+}
+
+bool ShmRingWriter::append(uint64_t timestamp, uint32_t feed_id, std::string_view message)
+{
+    const uint64_t ring_bytes = header_->ring_bytes;
+    const uint64_t needed = sizeof(ShmRecordHeader) + ((message.size() + 7) & ~uint64_t(7));
+    const uint64_t offset = pending_pos_ & mask_;
+    const uint64_t contiguous = ring_bytes - offset;
+    const uint64_t total = needed + (contiguous < needed ? contiguous : 0);
+
+    if (needed > ring_bytes / 2 || message.size() >= SHM_WRAP_MARKER)
+    {
+        ring_->dropped.store(ring_->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    if (pending_pos_ + total > limit_)
+    {
+        // Readers may have moved on since the limit was cached
+        limit_ = slowest_reader(false) + ring_bytes;
+        if (pending_pos_ + total > limit_)
+        {
+            limit_ = slowest_reader(true) + ring_bytes;
+            if (pending_pos_ + total > limit_)
+            {
+                ring_->dropped.store(ring_->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+    }
+
+    if (contiguous < needed)
+    {
+        memcpy(data_ + offset, &SHM_WRAP_MARKER, sizeof(SHM_WRAP_MARKER));
+        pending_pos_ += contiguous;
+    }
+    ShmRecordHeader record;
+    record.length = static_cast<uint32_t>(message.size());
+    record.feed_id = feed_id;
+    record.timestamp = timestamp;
+    char* out = data_ + (pending_pos_ & mask_);
+    memcpy(out, &record, sizeof(record));
+    memcpy(out + sizeof(record), message.data(), message.size());
+    pending_pos_ += needed;
+    ++pending_records_;
+    return true;
+}
+
+void ShmRingWriter::commit()
+{
+    if (pending_pos_ == ring_->write_pos.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    ring_->records_written.store(pending_records_, std::memory_order_relaxed);
+    ring_->write_pos.store(pending_pos_, std::memory_order_release);
+    segment_.notify();
+}
+
+uint64_t ShmRingWriter::backlog(const ShmSegment& segment, size_t ring_index)
+{
+    const ShmSegmentHeader* header = segment.header();
+    const ShmRingHeader* ring = segment.ring(ring_index);
+    uint64_t written = ring->records_written.load(std::memory_order_relaxed);
+    uint64_t backlog = 0;
+    for (size_t slot = 0; slot < header->max_readers; ++slot)
+    {
+        if (header->readers[slot].active.load(std::memory_order_acquire) == 0)
+        {
+            continue;
+        }
+        uint64_t read = ring->cursors[slot].records_read.load(std::memory_order_relaxed);
+        if (written > read && written - read > backlog)
+        {
+            backlog = written - read;
+        }
+    }
+    return backlog;
+}
+
+ShmRingReader::~ShmRingReader()
+{
+    close();
+}
+
+bool ShmRingReader::open(const std::string& name)
+{
+    close();
+    if (!segment_.attach(name))
+    {
+        return false;
+    }
+    ShmSegmentHeader* header = segment_.header();
+    const int32_t pid = static_cast<int32_t>(getpid());
+    for (size_t slot = 0; slot < header->max_readers; ++slot)
+    {
+        int32_t expected = 0;
+        if (!header->readers[slot].pid.compare_exchange_strong(expected, pid, std::memory_order_acq_rel))
+        {
+            continue;
+        }
+        // Start at the current end of every ring, then let the writer see the cursors
+        for (size_t index = 0; index < header->ring_count; ++index)
+        {
+            ShmRingHeader* ring = segment_.ring(index);
+            ShmCursor& cursor = ring->cursors[slot];
+            cursor.records_read.store(ring->records_written.load(std::memory_order_acquire), std::memory_order_relaxed);
+            cursor.read_pos.store(ring->write_pos.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+        header->readers[slot].active.store(1, std::memory_order_release);
+        slot_ = slot;
+        next_ring_ = 0;
+        attached_ = true;
+        return true;
+    }
+    std::cerr << "Shared memory " << name << " has no free reader slot\n";
+    segment_.close();
+    return false;
+}
+
+void ShmRingReader::close()
+{
+    if (!attached_)
+    {
+        return;
+    }
+    ShmReaderSlot& reader = segment_.header()->readers[slot_];
+    reader.active.store(0, std::memory_order_release);
+    reader.pid.store(0, std::memory_order_release);
+    segment_.close();
+    attached_ = false;
+}
+
+bool ShmRingReader::has_data() const
+{
+    const ShmSegmentHeader* header = segment_.header();
+    for (size_t index = 0; index < header->ring_count; ++index)
+    {
+        const ShmRingHeader* ring = segment_.ring(index);
+        if (ring->cursors[slot_].read_pos.load(std::memory_order_relaxed) <
+            ring->write_pos.load(std::memory_order_acquire))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShmRingReader::wait(int timeout_ms)
+{
+    ShmSegmentHeader* header = segment_.header();
+    uint32_t seen = header->futex.load(std::memory_order_seq_cst);
+    if (has_data() || header->closed.load(std::memory_order_acquire) != 0)
+    {
+        return;
+    }
+    segment_.wait(seen, timeout_ms);
+}
+
+bool ShmRingReader::finished() const
+{
+    return segment_.header()->closed.load(std::memory_order_acquire) != 0 && !has_data();
+}
+
+uint64_t ShmRingReader::dropped() const
+{
+    uint64_t dropped = 0;
+    const ShmSegmentHeader* header = segment_.header();
+    for (size_t index = 0; index < header->ring_count; ++index)
+    {
+        dropped += segment_.ring(index)->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
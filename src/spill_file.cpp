@@ -0,0 +1,169 @@
+// src/spill_file.cpp
+
+#include "ingestion/spill_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // Write the whole range, retrying on short writes and EINTR
+    bool write_all(int fd, const char* data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+            ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    bool read_all(int fd, char* data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+            ssize_t count = pread(fd, data, size, static_cast<off_t>(offset));
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+            offset += static_cast<uint64_t>(count);
+        }
+        return true;
+    }
+}
+
+SpillFile::~SpillFile()
+{
+    close();
+}
+
+bool SpillFile::open(const std::string& path)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1)
+    {
+        std::cerr << "Failed to open spill file " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    path_ = path;
+    read_offset_ = 0;
+    write_offset_ = 0;
+    pending_ = 0;
+    write_buffer_.clear();
+    write_buffer_.reserve(WRITE_BUFFER_SIZE);
+    return true;
+}
+
+void SpillFile::close()
+{
+    if (fd_ != -1)
+    {
+        ::close(fd_);
+        unlink(path_.c_str());
+        fd_ = -1;
+    }
+}
+
+bool SpillFile::append(uint64_t timestamp, uint32_t feed_id, std::string_view message)
+{
+    if (fd_ == -1)
+    {
+        return false;
+    }
+    uint32_t length = static_cast<uint32_t>(message.size());
+    size_t record_size = sizeof(timestamp) + sizeof(feed_id) + sizeof(length) + length;
+    if (write_buffer_.size() + record_size > WRITE_BUFFER_SIZE && !flush())
+    {
+        return false;
+    }
+    const char* ts_bytes = reinterpret_cast<const char*>(&timestamp);
+    const char* feed_bytes = reinterpret_cast<const char*>(&feed_id);
+    const char* len_bytes = reinterpret_cast<const char*>(&length);
+    write_buffer_.insert(write_buffer_.end(), ts_bytes, ts_bytes + sizeof(timestamp));
+    write_buffer_.insert(write_buffer_.end(), feed_bytes, feed_bytes + sizeof(feed_id));
+    write_buffer_.insert(write_buffer_.end(), len_bytes, len_bytes + sizeof(length));
+    write_buffer_.insert(write_buffer_.end(), message.begin(), message.end());
+    ++pending_;
+    return true;
+}
+
+bool SpillFile::read_next(uint64_t& timestamp, uint32_t& feed_id, std::string& message)
+{
+    if (fd_ == -1 || pending_ == 0)
+    {
+        return false;
+    }
+    // Make buffered records visible to pread before reading them back
+    if (read_offset_ == write_offset_ && !flush())
+    {
+        return false;
+    }
+
+    uint32_t length = 0;
+    char header[sizeof(timestamp) + sizeof(feed_id) + sizeof(length)];
+    if (!read_all(fd_, header, sizeof(header), read_offset_))
+    {
+        std::cerr << "Failed to read spill file " << path_ << "\n";
+        return false;
+    }
+    memcpy(&timestamp, header, sizeof(timestamp));
+    memcpy(&feed_id, header + sizeof(timestamp), sizeof(feed_id));
+    memcpy(&length, header + sizeof(timestamp) + sizeof(feed_id), sizeof(length));
+    message.resize(length);
+    if (length > 0 && !read_all(fd_, &message[0], length, read_offset_ + sizeof(header)))
+    {
+        std::cerr << "Failed to read spill file " << path_ << "\n";
+        return false;
+    }
+    read_offset_ += sizeof(header) + length;
+    --pending_;
+
+    // Reader caught up: reclaim the disk space
+    if (pending_ == 0)
+    {
+        if (ftruncate(fd_, 0) != 0)
+        {
+            std::cerr << "Failed to truncate spill file " << path_ << ": " << strerror(errno) << "\n";
+        }
+        read_offset_ = 0;
+        write_offset_ = 0;
+    }
+    return true;
+}
+
+bool SpillFile::flush()
+{
+    if (write_buffer_.empty())
+    {
+        return true;
+    }
+    if (!write_all(fd_, write_buffer_.data(), write_buffer_.size(), write_offset_))
+    {
+        std::cerr << "Failed to write spill file " << path_ << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    write_offset_ += write_buffer_.size();
+    write_buffer_.clear();
+    return true;
+}